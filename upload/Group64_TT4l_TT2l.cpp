@@ -18,8 +18,351 @@ Phone: 0192647906,0175568901.01115428845,0196424811
 #include <algorithm> // For sorting/searching
 #include <climits> // For max/min values
 #include <iomanip> 
+#include <thread> // Worker threads for batch runs
+#include <chrono> // Timing
+#include <mutex> 
+#include <condition_variable> 
+#include <functional> 
+#include <deque> 
+#include <map> 
+#include <set> 
+#include <atomic> 
+#include <cmath> 
+#include <sstream> 
+#include <cstring> 
+#include <cerrno> 
+#include <csignal> 
+#include <sys/socket.h> // Unix domain sockets for server mode
+#include <sys/un.h> 
+#include <unistd.h> 
+#include <sys/mman.h> // Memory-mapped logs for ingest/query
+#include <sys/stat.h> 
+#include <fcntl.h> 
+#include <sys/wait.h> // Worker processes for sweeps
+#include <dirent.h> 
+#include <sys/prctl.h> 
+#include <poll.h> 
+#include <new> 
+#include <string_view> 
+#include <unordered_map> 
+#include <unordered_set> 
+#include <memory> 
 using namespace std; 
 
+class Robot;
+
+// Small per-game random generator (xorshift32), so independent games
+// don't fight over the global rand() state
+inline unsigned nextRand(unsigned& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// splitmix64 finaliser: turns nearby inputs into unrelated 64-bit values
+inline unsigned long long mix64(unsigned long long v) {
+    v += 0x9E3779B97F4A7C15ULL;
+    v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    v = (v ^ (v >> 27)) * 0x94D049BB133111EBULL;
+    return v ^ (v >> 31);
+}
+
+// Spreads a seed out so neighbouring seeds give unrelated streams
+inline unsigned mixSeed(unsigned long long v) {
+    unsigned s = (unsigned)mix64(v);
+    return s ? s : 1; // xorshift must not start at 0
+}
+
+// Random numbers for the game being played on this thread
+thread_local unsigned* activeRng = nullptr;
+inline int gameRand() { return (int)(nextRand(*activeRng) & 0x7fffffff); }
+
+// Shuffle using the game's generator
+inline void shuffleRobots(vector<Robot*>& list) {
+    for (int i = (int)list.size() - 1; i > 0; --i) {
+        swap(list[i], list[gameRand() % (i + 1)]);
+    }
+}
+
+// EVENT BUS
+// The engine reports what happens as small plain events instead of printing.
+// Sinks decide what to do with them (narrate, record, count, or nothing).
+// With no sink attached an event costs one pointer check.
+enum EventType : unsigned char {
+    EV_TURN_START, EV_TURN_END,
+    EV_THINKING, EV_HIDDEN, EV_TRACKED, EV_SCANNED, EV_SAW, EV_SAW_NOBODY,
+    EV_FIRED, EV_BURST_DONE, EV_PATTERN, EV_NO_TARGET,
+    EV_HIT, EV_DESTROYED, EV_UPGRADE_EARNED, EV_UPGRADED,
+    EV_MOVED, EV_JUMPED, EV_RESPAWNED, EV_STALEMATE,
+    EV_COUNT
+};
+
+// Event::kind for EV_FIRED, EV_PATTERN and EV_NO_TARGET
+enum Weapon : unsigned char { W_DEFAULT, W_SEMIAUTO, W_LONGSHOT, W_PLUS, W_CROSS, W_DOUBLEROW };
+// Event::kind for EV_HIDDEN
+enum HideReason : unsigned char { HIDE_UPGRADE, HIDE_HIDEBOT, HIDE_BLOCKED };
+// Event::kind for EV_DESTROYED and EV_MOVED
+enum DestroyReason : unsigned char { DESTROY_KILLED, DESTROY_SELF };
+enum MoveKind : unsigned char { MOVE_TOWARD, MOVE_WANDER };
+// Event::kind for EV_STALEMATE
+enum StalemateReason : unsigned char { STALE_QUIET, STALE_REPEAT };
+// Event::kind for EV_UPGRADED
+enum UpgradeKind : unsigned char {
+    UP_JUMPBOT, UP_HIDEBOT, UP_LONGSHOTBOT, UP_SEMIAUTOBOT, UP_THIRTYSHOTBOT,
+    UP_PLUSSHOOTER, UP_CROSSSHOOTER, UP_DOUBLEROWSHOOTER, UP_SCOUTBOT, UP_TRACKBOT
+};
+const char* const EVENT_NAMES[] = {
+    "TurnStart", "TurnEnd", "Thinking", "Hidden", "Tracked", "Scanned", "Saw", "SawNobody",
+    "Fired", "BurstDone", "Pattern", "NoTarget", "Hit", "Destroyed", "UpgradeEarned", "Upgraded",
+    "Moved", "Jumped", "Respawned", "Stalemate"
+};
+const char* const UPGRADE_NAMES[] = {
+    "JumpBot", "HideBot", "LongShotBot", "SemiAutoBot", "ThirtyShotBot",
+    "PlusShooter", "CrossShooter", "DoubleRowShooter", "ScoutBot", "TrackBot"
+};
+
+struct Event {
+    EventType type;
+    unsigned char kind;  // Weapon / HideReason / ... depending on type
+    bool hit;            // EV_FIRED: shot landed
+    int turn;
+    const Robot* actor;  // robot the event is about
+    const Robot* target; // other robot involved, if any
+    int x, y;            // where it happened
+    int value;           // health, hits, distance, count... depending on type
+};
+
+class EventSink {
+public:
+    virtual void onEvent(const Event& e) = 0;
+    virtual ~EventSink() {}
+};
+
+class EventBus {
+    vector<EventSink*> sinks;
+public:
+    int turn = 0; // stamped on every event
+
+    void attach(EventSink* sink) { sinks.push_back(sink); }
+    void detach(EventSink* sink) { sinks.erase(remove(sinks.begin(), sinks.end(), sink), sinks.end()); }
+    bool empty() const { return sinks.empty(); }
+    void publish(Event& e) {
+        e.turn = turn;
+        for (EventSink* sink : sinks) sink->onEvent(e);
+    }
+};
+
+// Bus of the game being played on this thread
+thread_local EventBus* activeBus = nullptr;
+
+inline void emitEvent(EventType type, const Robot* actor, unsigned char kind = 0, const Robot* target = nullptr,
+                      int x = 0, int y = 0, int value = 0, bool hit = false) {
+    if (!activeBus || activeBus->empty()) return;
+    Event e{ type, kind, hit, 0, actor, target, x, y, value };
+    activeBus->publish(e);
+}
+
+// ZOBRIST HASHING
+// The game state hash is the XOR of one key per (robot, field, value).
+// Keys come from mix64 rather than a table, so any map size or value range
+// works. Robot setters swap the old key for the new one as state changes,
+// so the hash is always current without rescanning the robots.
+enum ZobristField {
+    Z_POS, Z_ALIVE, Z_HIDDEN, Z_HEALTH, Z_SHELLS, Z_LIVES,
+    Z_MOVE_UP, Z_SHOOT_UP, Z_SEE_UP, Z_JUMPS, Z_HIDES, Z_SCANS
+};
+
+inline unsigned long long zobristKey(int id, int field, int value) {
+    return mix64(((unsigned long long)(unsigned)id << 36) ^ ((unsigned long long)field << 32) ^ (unsigned)value);
+}
+
+// Hash of the game being played on this thread
+thread_local unsigned long long* activeHash = nullptr;
+
+// 0 for no upgrade, otherwise UpgradeKind + 1
+inline int upgradeCode(const string& name) {
+    for (int i = 0; i < (int)(sizeof(UPGRADE_NAMES) / sizeof(UPGRADE_NAMES[0])); ++i) {
+        if (name == UPGRADE_NAMES[i]) return i + 1;
+    }
+    return 0;
+}
+
+// HEATMAPS
+// Per-cell counters for occupancy, shots fired, hits and deaths, merged
+// across games. The hooks are only compiled in with -DROBOTWAR_HEATMAP,
+// so normal builds pay nothing for them.
+struct Heatmap {
+    int width = 0, height = 0;
+    vector<unsigned> occupancy, shots, hits, deaths;
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        for (auto* layer : { &occupancy, &shots, &hits, &deaths }) layer->assign(w * h, 0);
+    }
+
+    void merge(const Heatmap& other) {
+        if (width == 0) resize(other.width, other.height);
+        if (other.width != width || other.height != height) return;
+        for (int i = 0; i < width * height; ++i) {
+            occupancy[i] += other.occupancy[i];
+            shots[i] += other.shots[i];
+            hits[i] += other.hits[i];
+            deaths[i] += other.deaths[i];
+        }
+    }
+
+    void count(vector<unsigned>& layer, int x, int y) {
+        if (x >= 0 && y >= 0 && x < width && y < height) layer[y * width + x]++;
+    }
+};
+
+#ifdef ROBOTWAR_HEATMAP
+const bool HEATMAPS_ENABLED = true;
+thread_local Heatmap* activeHeatmap = nullptr;
+#define HEAT_COUNT(layer, x, y) do { if (activeHeatmap) activeHeatmap->count(activeHeatmap->layer, (x), (y)); } while (0)
+#else
+const bool HEATMAPS_ENABLED = false;
+#define HEAT_COUNT(layer, x, y) do {} while (0)
+#endif
+
+// TELEMETRY
+// Live counters for long runs. Each thread gets its own block of counters,
+// written only by that thread with relaxed atomics, so counting costs an
+// uncontended load and store. A sampler thread sums the blocks and exports
+// them (see TelemetrySampler). When a thread exits its totals are folded into
+// telemetryRetired and its block is freed, so short-lived worker threads
+// don't pile up. With telemetry off every hook is one check of a global flag.
+struct TelemetryCounters {
+    atomic<long long> turns{0}, shots{0}, hits{0}, logBytes{0}, allocations{0}, respawnTries{0};
+    atomic<long long> alive{0}, respawnQueue{0}; // gauges: last turn's values
+    atomic<int> inRespawnSearch{0};              // 1 while looking for a free cell
+    atomic<long long> lastTurnNs{0};             // steady clock time of last turn
+    int id = 0;                                  // thread label in the export
+};
+
+// Counter totals of threads that have exited
+struct TelemetryTotals {
+    long long turns = 0, shots = 0, hits = 0, logBytes = 0, allocations = 0, respawnTries = 0;
+};
+
+bool telemetryEnabled = false; // set in main before any threads start
+mutex telemetryLock;           // guards everything below
+vector<TelemetryCounters*> telemetryThreads; // running threads only
+TelemetryTotals telemetryRetired;
+int telemetryNextId = 0;
+thread_local TelemetryCounters* threadCounters = nullptr;
+thread_local bool telemetryThreadDone = false; // exit handler has run
+
+// Folds this thread's counters into the retired totals when the thread exits
+struct TelemetryThreadExit {
+    ~TelemetryThreadExit() {
+        telemetryThreadDone = true;
+        TelemetryCounters* c = threadCounters;
+        if (!c) return;
+        threadCounters = nullptr;
+        lock_guard<mutex> lock(telemetryLock);
+        telemetryRetired.turns += c->turns;
+        telemetryRetired.shots += c->shots;
+        telemetryRetired.hits += c->hits;
+        telemetryRetired.logBytes += c->logBytes;
+        telemetryRetired.allocations += c->allocations;
+        telemetryRetired.respawnTries += c->respawnTries;
+        telemetryThreads.erase(find(telemetryThreads.begin(), telemetryThreads.end(), c));
+        delete c;
+    }
+};
+
+inline TelemetryCounters* telemetry() {
+    if (!telemetryEnabled || telemetryThreadDone) return nullptr;
+    if (!threadCounters) {
+        static thread_local TelemetryThreadExit onExit;
+        (void)onExit;
+        TelemetryCounters* c = new TelemetryCounters;
+        lock_guard<mutex> lock(telemetryLock);
+        c->id = telemetryNextId++;
+        telemetryThreads.push_back(c);
+        threadCounters = c;
+    }
+    return threadCounters;
+}
+
+// Only the owning thread writes, so no read-modify-write is needed
+inline void bump(atomic<long long>& counter, long long n) {
+    counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+#define TELEMETRY_ADD(field, n) do { if (TelemetryCounters* t_ = telemetry()) bump(t_->field, (n)); } while (0)
+#define TELEMETRY_SET(field, v) do { if (TelemetryCounters* t_ = telemetry()) t_->field.store((v), memory_order_relaxed); } while (0)
+
+// Count every heap allocation made by a thread that has counters. This
+// replaces the global operator new for the whole program, so it is only
+// compiled in with -DROBOTWAR_COUNT_ALLOCS. Every replaceable form of new
+// and delete is here so they always pair up, and they stay out of line so
+// the compiler never sees a pointer from operator new reach free().
+#ifdef ROBOTWAR_COUNT_ALLOCS
+const bool ALLOC_COUNTING_ENABLED = true;
+#define TELEMETRY_ALLOC __attribute__((noinline))
+
+TELEMETRY_ALLOC void* countedAlloc(size_t size, size_t align) {
+    if (threadCounters) bump(threadCounters->allocations, 1);
+    if (size == 0) size = 1;
+    if (align <= alignof(max_align_t)) return malloc(size);
+    void* p = nullptr;
+    return posix_memalign(&p, align, size) == 0 ? p : nullptr;
+}
+
+TELEMETRY_ALLOC void* countedNew(size_t size, size_t align) {
+    if (void* p = countedAlloc(size, align)) return p;
+    throw bad_alloc();
+}
+
+TELEMETRY_ALLOC void* operator new(size_t size) { return countedNew(size, 0); }
+TELEMETRY_ALLOC void* operator new[](size_t size) { return countedNew(size, 0); }
+TELEMETRY_ALLOC void* operator new(size_t size, align_val_t a) { return countedNew(size, (size_t)a); }
+TELEMETRY_ALLOC void* operator new[](size_t size, align_val_t a) { return countedNew(size, (size_t)a); }
+TELEMETRY_ALLOC void* operator new(size_t size, const nothrow_t&) noexcept { return countedAlloc(size, 0); }
+TELEMETRY_ALLOC void* operator new[](size_t size, const nothrow_t&) noexcept { return countedAlloc(size, 0); }
+TELEMETRY_ALLOC void* operator new(size_t size, align_val_t a, const nothrow_t&) noexcept { return countedAlloc(size, (size_t)a); }
+TELEMETRY_ALLOC void* operator new[](size_t size, align_val_t a, const nothrow_t&) noexcept { return countedAlloc(size, (size_t)a); }
+
+TELEMETRY_ALLOC void operator delete(void* p) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete(void* p, size_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p, size_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete(void* p, align_val_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p, align_val_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p, size_t, align_val_t) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { free(p); }
+TELEMETRY_ALLOC void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { free(p); }
+#else
+const bool ALLOC_COUNTING_ENABLED = false;
+#endif
+
+// NEIGHBOUR SETS
+// Every living robot keeps a list of the living robots in the 8 cells around
+// it. The lists are patched only when a robot moves, dies or respawns, so
+// seeing and "is this cell free?" no longer scan the whole robot list.
+class NeighbourIndex {
+public:
+    void add(Robot* r);    // r is now alive at its position
+    void remove(Robot* r); // r is leaving its cell (moving or dying)
+    bool occupied(int x, int y) const { return cells.count(key(x, y)) != 0; }
+    void clear() { cells.clear(); }
+
+private:
+    // Shifted as unsigned: y can be -1 for cells just off the map
+    static long long key(int x, int y) { return (long long)(((unsigned long long)(unsigned)y << 32) | (unsigned)x); }
+    unordered_map<long long, vector<Robot*>> cells; // living robots per cell
+};
+
+// Neighbour index of the game being played on this thread
+thread_local NeighbourIndex* activeNeighbours = nullptr;
+
 // Base class for all robots
 class Robot {
 private:
@@ -28,8 +371,24 @@ private:
 protected:
     // Protected setter for position
     void setPosition(int newX, int newY) {
+        rehash(Z_POS, y * 65536 + x, newY * 65536 + newX);
+        if (activeNeighbours && alive) activeNeighbours->remove(this);
         x = newX;
         y = newY;
+        if (activeNeighbours && alive) activeNeighbours->add(this);
+    }
+
+    // Heatmap and telemetry count of one shot fired from here
+    void countShot() {
+        HEAT_COUNT(shots, x, y);
+        TELEMETRY_ADD(shots, 1);
+    }
+
+    // Swap a field's Zobrist key in the active game hash
+    void rehash(int field, int oldValue, int newValue) {
+        if (activeHash && oldValue != newValue) {
+            *activeHash ^= zobristKey(id, field, oldValue) ^ zobristKey(id, field, newValue);
+        }
     }
 
 public:
@@ -56,12 +415,61 @@ public:
     int hidesLeft = 0; //HideBot counter
     bool hidden = false; //hidebot status
     int jumpsLeft = 0; //JumpBot counter
+    int id = 0;        // index in the game's robot list
+    vector<Robot*> neighbours; // living robots in the 8 cells around (kept by NeighbourIndex)
 
     //Constructor - Sets up new robot
     Robot(string n, char s, int ix, int iy, int hp, int ammo, int l)
         : name(n), symbol(s), x(ix), y(iy), health(hp), shells(ammo), lives(l), alive(true),
           initHealth(hp), initShells(ammo) {}
+
+    virtual ~Robot() {}
     
+    // Setters for hashed state
+    void setHealth(int n) { rehash(Z_HEALTH, health, n); health = n; }
+    void setShells(int n) { rehash(Z_SHELLS, shells, n); shells = n; }
+    void setLives(int n) { rehash(Z_LIVES, lives, n); lives = n; }
+    void setAlive(bool a) {
+        rehash(Z_ALIVE, alive, a);
+        if (activeNeighbours && alive && !a) activeNeighbours->remove(this);
+        if (activeNeighbours && !alive && a) { alive = a; activeNeighbours->add(this); }
+        alive = a;
+    }
+    void setHidden(bool h) { rehash(Z_HIDDEN, hidden, h); hidden = h; }
+    void setJumpsLeft(int n) { rehash(Z_JUMPS, jumpsLeft, n); jumpsLeft = n; }
+    void setHidesLeft(int n) { rehash(Z_HIDES, hidesLeft, n); hidesLeft = n; }
+    void setScansLeft(int n) { rehash(Z_SCANS, scansLeft, n); scansLeft = n; }
+
+    // Take an upgrade in its category (movement, shooting or vision)
+    void applyUpgrade(UpgradeKind kind) {
+        if (kind <= UP_HIDEBOT) {
+            rehash(Z_MOVE_UP, upgradeCode(moveUpgradeName), kind + 1);
+            upgradedMoving = true;
+            moveUpgradeName = UPGRADE_NAMES[kind];
+        } else if (kind <= UP_DOUBLEROWSHOOTER) {
+            rehash(Z_SHOOT_UP, upgradeCode(shootingUpgradeName), kind + 1);
+            upgradedShooting = true;
+            shootingUpgradeName = UPGRADE_NAMES[kind];
+        } else {
+            rehash(Z_SEE_UP, upgradeCode(seeingUpgradeName), kind + 1);
+            upgradedSeeing = true;
+            seeingUpgradeName = UPGRADE_NAMES[kind];
+        }
+    }
+
+    // This robot's share of the game hash, computed from scratch
+    unsigned long long zobrist() const {
+        int fields[][2] = {
+            { Z_POS, y * 65536 + x }, { Z_ALIVE, alive }, { Z_HIDDEN, hidden }, { Z_HEALTH, health },
+            { Z_SHELLS, shells }, { Z_LIVES, lives }, { Z_MOVE_UP, upgradeCode(moveUpgradeName) },
+            { Z_SHOOT_UP, upgradeCode(shootingUpgradeName) }, { Z_SEE_UP, upgradeCode(seeingUpgradeName) },
+            { Z_JUMPS, jumpsLeft }, { Z_HIDES, hidesLeft }, { Z_SCANS, scansLeft }
+        };
+        unsigned long long h = 0;
+        for (auto& f : fields) h ^= zobristKey(id, f[0], f[1]);
+        return h;
+    }
+
     //virtual functions
     virtual void think(const vector<Robot*>& robots, int width, int height) = 0;
     virtual void look(const vector<Robot*>& robots) = 0;
@@ -72,15 +480,18 @@ public:
     bool takeDamage() {
         if (!alive) return false; // check
         if (hidden) { // HideBot protection
-            cout << name << " is hidden, so it takes no damage." << endl;
+            emitEvent(EV_HIDDEN, this, HIDE_BLOCKED);
             return false;
         }
-        health--; // 
-        cout << "  "<< name << " is hit! (Health=" << health << ")\n";
+        setHealth(health - 1); // 
+        HEAT_COUNT(hits, x, y);
+        TELEMETRY_ADD(hits, 1);
+        emitEvent(EV_HIT, this, 0, nullptr, x, y, health);
         if (health <= 0) { // Check
-            alive = false;
+            setAlive(false);
             deaths++; 
-            cout << "  "<< name << " is destroyed!\n";
+            HEAT_COUNT(deaths, x, y);
+            emitEvent(EV_DESTROYED, this, DESTROY_KILLED, nullptr, x, y);
             return true; // Confirmed kill
         }
         return false; //alive
@@ -89,20 +500,21 @@ public:
     //Self-destruct sequence
     void destroySelf() {
         if (!alive) return; // check
-        alive = false;
+        setAlive(false);
         deaths++; 
-        cout << name << " self-destructs!\n"; 
+        HEAT_COUNT(deaths, x, y);
+        emitEvent(EV_DESTROYED, this, DESTROY_SELF, nullptr, x, y);
     }
 
     //Come back to life
     void respawn(int newX, int newY) {
         setPosition(newX, newY); // New position
-        health = initHealth; // Reset health
-        alive = true;
+        setHealth(initHealth); // Reset health
+        setAlive(true);
         sawTarget = false;
-        hidden = false;
+        setHidden(false);
         seenTargets.clear(); // Clear enemy memory
-        cout << name << " respawns at (" << newX << "," << newY << ") with " << health << " health and " << shells << " shells" << endl;
+        emitEvent(EV_RESPAWNED, this, 0, nullptr, newX, newY, health);
     }
 
     //Shooting range based on upgrades
@@ -154,6 +566,34 @@ ostream& operator<<(ostream& os, const Robot& robot) {
     return os;
 }
 
+void NeighbourIndex::add(Robot* r) {
+    int x = r->getX(), y = r->getY();
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            if (dx == 0 && dy == 0) continue;
+            auto it = cells.find(key(x + dx, y + dy));
+            if (it == cells.end()) continue;
+            for (Robot* w : it->second) { // Both see each other now
+                w->neighbours.push_back(r);
+                r->neighbours.push_back(w);
+            }
+        }
+    }
+    cells[key(x, y)].push_back(r);
+}
+
+void NeighbourIndex::remove(Robot* r) {
+    for (Robot* w : r->neighbours) {
+        auto& list = w->neighbours;
+        list.erase(find(list.begin(), list.end(), r));
+    }
+    r->neighbours.clear();
+    auto it = cells.find(key(r->getX(), r->getY()));
+    if (it == cells.end()) return;
+    it->second.erase(find(it->second.begin(), it->second.end(), r));
+    if (it->second.empty()) cells.erase(it);
+}
+
 // ABSTRACT CLASS - ThinkingRobot
 class ThinkingRobot {
 public:
@@ -218,11 +658,11 @@ public:
     void performThinking(const vector<Robot*>& robots, int width, int height) override {
         // HideBot special handling
         if (upgradedMoving && moveUpgradeName == "HideBot" && hidesLeft > 0) {
-            cout << name << " is hidden and invulnerable this turn." << endl;
-            hidden = true; // Activate cloak
-            hidesLeft--; // Use one hide
+            emitEvent(EV_HIDDEN, this, HIDE_UPGRADE);
+            setHidden(true); // Activate cloak
+            setHidesLeft(hidesLeft - 1); // Use one hide
         } else {
-            cout << name << " is thinking..." << endl; // Robot is pondering
+            emitEvent(EV_THINKING, this); // Robot is pondering
         }
         
         // Standard thinking sequence
@@ -247,13 +687,13 @@ public:
                         available.push_back(r); // Add living targets
                     }
                 }
-                random_shuffle(available.begin(), available.end()); // random
+                shuffleRobots(available); // random
                 int toTrack = min(3, (int)available.size()); //3 bots
                 for (int i = 0; i < toTrack; i++) {
                     trackedBots.push_back(available[i]); // Add to tracking list
                 }
                 trackBotHasScanned = true; 
-                cout << name << " tracked " << toTrack << " robots." << endl;
+                emitEvent(EV_TRACKED, this, 0, nullptr, getX(), getY(), toTrack);
             }
 
             // Adds tracked bots to visible list
@@ -267,8 +707,7 @@ public:
         // ScoutBot full map look
         if (upgradedSeeing && seeingUpgradeName == "ScoutBot" &&
             scansLeft > 0) {
-            cout << name << " uses ScoutBot scan ("
-                 << scansLeft << " left):\n";
+            emitEvent(EV_SCANNED, this, 0, nullptr, getX(), getY(), scansLeft);
             for (auto r : robots) {
                 if (r != this && r->isAlive() && !r->hidden) {
                     // Add if not already in list
@@ -277,25 +716,25 @@ public:
                     }
                 }
             }
-            scansLeft--; 
+            setScansLeft(scansLeft - 1); 
         }
 
-        // Check adjacent squares (normal vision)
+        // Check adjacent squares (normal vision), read from the neighbour
+        // set in the old scan order: column by column, then robot list order
         int currentX = getX();
         int currentY = getY();
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                if (dx == 0 && dy == 0) continue; // Skip self
-                int nx = currentX + dx, ny = currentY + dy;
-                for (auto r : robots) {
-                    if (r != this && r->isAlive() && !r->hidden &&
-                        r->getX() == nx && r->getY() == ny) {
-                        // Add if we see them
-                        if (find(seenTargets.begin(), seenTargets.end(), r) == seenTargets.end()) {
-                            seenTargets.push_back(r);
-                        }
-                    }
-                }
+        vector<Robot*> adjacent;
+        for (Robot* r : neighbours) {
+            if (!r->hidden) adjacent.push_back(r);
+        }
+        auto scanOrder = [&](Robot* r) {
+            return make_pair((r->getX() - currentX) * 3 + (r->getY() - currentY), r->id);
+        };
+        sort(adjacent.begin(), adjacent.end(), [&](Robot* a, Robot* b) { return scanOrder(a) < scanOrder(b); });
+        for (Robot* r : adjacent) {
+            // Add if we see them
+            if (find(seenTargets.begin(), seenTargets.end(), r) == seenTargets.end()) {
+                seenTargets.push_back(r);
             }
         }
 
@@ -303,10 +742,10 @@ public:
         sawTarget = !seenTargets.empty();
         if (sawTarget) {
             for (auto r : seenTargets) {
-                cout << "  " << name << " sees " << r->name << " at (" << r->getX() << "," << r->getY() << ")\n";
+                emitEvent(EV_SAW, this, 0, r, r->getX(), r->getY());
             }
         } else {
-            cout << "  " << name << " sees no one.\n"; 
+            emitEvent(EV_SAW_NOBODY, this);
         }
     }
 
@@ -316,14 +755,14 @@ public:
 
         // SemiAutoBot
         if (shootingUpgradeName == "SemiAutoBot" && sawTarget) {
-            Robot* target = seenTargets[rand() % seenTargets.size()]; // Pick random target
-            cout << name << " (SemiAutoBot) fires 3 shots at "
-                 << target->name << "! ";
-            shells--; 
+            Robot* target = seenTargets[gameRand() % seenTargets.size()]; // Pick random target
+            emitEvent(EV_FIRED, this, W_SEMIAUTO, target, target->getX(), target->getY(), 3);
+            setShells(shells - 1); 
             int hits = 0;
             bool destroyed = false;
             for (int i = 0; i < 3; i++) { // 
-                if (rand() % 100 < 70) { // 70% hit chance
+                countShot();
+                if (gameRand() % 100 < 70) { // 70% hit chance
                     hits++;
                     if (target->takeDamage()) { // Check if killed
                         destroyed = true;
@@ -331,11 +770,7 @@ public:
                     }
                 }
             }
-            if (hits > 0) {
-                cout << "HIT " << hits << " times!\n";
-            } else {
-                cout << "All shots miss.\n"; 
-            }
+            emitEvent(EV_BURST_DONE, this, W_SEMIAUTO, target, target->getX(), target->getY(), hits);
             if (shells <= 0) destroySelf(); 
             return;
         }
@@ -354,43 +789,43 @@ public:
                 }
             }
             if (!candidates.empty()) {
-                Robot* target = candidates[rand() % candidates.size()]; // Random valid target
-                cout << name << " (LongShotBot) fires at "
-                     << target->name << " (dist=" << abs(target->getX() - currentX) + abs(target->getY() - currentY) << ")... ";
-                shells--;
-                if (rand() % 100 < 70) { // 70% hit chance
-                    cout << "HIT!\n";
+                Robot* target = candidates[gameRand() % candidates.size()]; // Random valid target
+                int dist = abs(target->getX() - currentX) + abs(target->getY() - currentY);
+                setShells(shells - 1);
+                countShot();
+                if (gameRand() % 100 < 70) { // 70% hit chance
+                    emitEvent(EV_FIRED, this, W_LONGSHOT, target, target->getX(), target->getY(), dist, true);
                     if (target->takeDamage()) {
                         kills++; //
                     }
                 } else {
-                    cout << "misses.\n";
+                    emitEvent(EV_FIRED, this, W_LONGSHOT, target, target->getX(), target->getY(), dist, false);
                 }
                 if (shells <= 0) destroySelf();
                 return;
             } else {
-                cout << name << " (LongShotBot) sees no target within 3-unit range." << endl;
+                emitEvent(EV_NO_TARGET, this, W_LONGSHOT);
             }
         }
 
         // PlusShooter: Horizontal/Vertical attack
         if (shootingUpgradeName == "PlusShooter") {
-            cout << name << " fires in + pattern!" << endl;
+            emitEvent(EV_PATTERN, this, W_PLUS);
             bool fired = false;
             int currentX = getX();
             int currentY = getY();
             for (Robot* r : seenTargets) {
                 if ((r->getX() == currentX || r->getY() == currentY) && !(r->getX() == currentX && r->getY() == currentY)) {
-                    cout << "  Targeting " << r->name << " at (" << r->getX() << "," << r->getY() << ")... ";
-                    shells--;
+                    setShells(shells - 1);
+                    countShot();
                     fired = true;
-                    if (rand() % 100 < 70) { // Hit check
-                        cout << "HIT!" << endl;
+                    if (gameRand() % 100 < 70) { // Hit check
+                        emitEvent(EV_FIRED, this, W_PLUS, r, r->getX(), r->getY(), 0, true);
                         if (r->takeDamage()) {
                             kills++;
                         }
                     } else {
-                        cout << "missed." << endl;
+                        emitEvent(EV_FIRED, this, W_PLUS, r, r->getX(), r->getY(), 0, false);
                     }
                     if (shells <= 0) {
                         destroySelf(); 
@@ -399,7 +834,7 @@ public:
                 }
             }
             if (!fired) {
-                cout << "  No valid targets in + pattern, falling back to regular fire." << endl;
+                emitEvent(EV_NO_TARGET, this, W_PLUS);
             } else {
                 return; // Done if we fired
             }
@@ -407,22 +842,22 @@ public:
 
         // CrossShooter: Diagonal attack
         if (shootingUpgradeName == "CrossShooter") {
-            cout << name << " fires in X pattern!" << endl;
+            emitEvent(EV_PATTERN, this, W_CROSS);
             bool fired = false;
             int currentX = getX();
             int currentY = getY();
             for (Robot* r : seenTargets) {
                 if (abs(r->getX() - currentX) == abs(r->getY() - currentY) && !(r->getX() == currentX && r->getY() == currentY)) {
-                    cout << "  Targeting " << r->name << " at (" << r->getX() << "," << r->getY() << ")... ";
-                    shells--;
+                    setShells(shells - 1);
+                    countShot();
                     fired = true;
-                    if (rand() % 100 < 70) { // Hit check
-                        cout << "HIT!" << endl;
+                    if (gameRand() % 100 < 70) { // Hit check
+                        emitEvent(EV_FIRED, this, W_CROSS, r, r->getX(), r->getY(), 0, true);
                         if (r->takeDamage()) {
                             kills++;
                         }
                     } else {
-                        cout << "missed." << endl;
+                        emitEvent(EV_FIRED, this, W_CROSS, r, r->getX(), r->getY(), 0, false);
                     }
                     if (shells <= 0) {
                         destroySelf();
@@ -431,7 +866,7 @@ public:
                 }
             }
             if (!fired) {
-                cout << "  No valid targets in X pattern, falling back to regular fire." << endl;
+                emitEvent(EV_NO_TARGET, this, W_CROSS);
             } else {
                 return;
             }
@@ -439,21 +874,21 @@ public:
 
         // DoubleRowShooter: Row-based attack
         if (shootingUpgradeName == "DoubleRowShooter") {
-            cout << name << " fires across two rows!" << endl;
+            emitEvent(EV_PATTERN, this, W_DOUBLEROW);
             bool fired = false;
             int currentY = getY();
             for (Robot* r : seenTargets) {
                 if (r->getY() == currentY || r->getY() == currentY + 1 || r->getY() == currentY - 1) {
-                    cout << "  Targeting " << r->name << " at (" << r->getX() << "," << r->getY() << ")... ";
-                    shells--;
+                    setShells(shells - 1);
+                    countShot();
                     fired = true;
-                    if (rand() % 100 < 70) { // Hit check
-                        cout << "HIT!" << endl;
+                    if (gameRand() % 100 < 70) { // Hit check
+                        emitEvent(EV_FIRED, this, W_DOUBLEROW, r, r->getX(), r->getY(), 0, true);
                         if (r->takeDamage()) {
                             kills++;
                         }
                     } else {
-                        cout << "missed." << endl;
+                        emitEvent(EV_FIRED, this, W_DOUBLEROW, r, r->getX(), r->getY(), 0, false);
                     }
                     if (shells <= 0) {
                         destroySelf();
@@ -462,7 +897,7 @@ public:
                 }
             }
             if (!fired) {
-                cout << "  No valid targets in row pattern, falling back to regular fire." << endl;
+                emitEvent(EV_NO_TARGET, this, W_DOUBLEROW);
             } else {
                 return;
             }
@@ -481,83 +916,80 @@ public:
         }
 
         if (adjacentTargets.empty()) {
-            cout << name << " sees no adjacent target to fire at." << endl;
+            emitEvent(EV_NO_TARGET, this, W_DEFAULT);
             return; 
         }
 
         // Shoot random adjacent target
-        Robot* target = adjacentTargets[rand() % adjacentTargets.size()];
-        cout << name << " fires at " << target->name << "... ";
-        shells--;
-        if (rand() % 100 < 70) { // 70% hit chance
-            cout << "HIT!" << endl;
+        Robot* target = adjacentTargets[gameRand() % adjacentTargets.size()];
+        setShells(shells - 1);
+        countShot();
+        if (gameRand() % 100 < 70) { // 70% hit chance
+            emitEvent(EV_FIRED, this, W_DEFAULT, target, target->getX(), target->getY(), 0, true);
             if (target->takeDamage()) {
                 kills++; // Add to kill count
             }
         } else {
-            cout << "misses." << endl; // 
+            emitEvent(EV_FIRED, this, W_DEFAULT, target, target->getX(), target->getY(), 0, false); // 
         }
         if (shells <= 0) destroySelf(); // self destructs conditon
 
 
         // UPGRADE SYSTEM
         if (target && !target->isAlive() && upgradeCount < 3) {
-            cout << name << " gets an upgrade!" << endl;
+            emitEvent(EV_UPGRADE_EARNED, this);
             vector<int> available; // Available upgrade slots
             if (!upgradedMoving) available.push_back(1); // Movement
             if (!upgradedShooting) available.push_back(2); // Shooting
             if (!upgradedSeeing) available.push_back(3); // Vision
 
             if (!available.empty()) {
-                int cat = available[rand() % available.size()]; // Random upgrade type
+                int cat = available[gameRand() % available.size()]; // Random upgrade type
                 switch (cat) {
                     case 1: {  // Movement upgrade
-                        upgradedMoving = true;
-                        if (rand() % 2 == 0) { // 50/50 choice
-                            moveUpgradeName = "JumpBot";
-                            jumpsLeft = 3; // Give 3 jumps
-                            cout << name << " upgraded to JumpBot." << endl;
+                        if (gameRand() % 2 == 0) { // 50/50 choice
+                            applyUpgrade(UP_JUMPBOT);
+                            setJumpsLeft(3); // Give 3 jumps
+                            emitEvent(EV_UPGRADED, this, UP_JUMPBOT);
                         } else {
-                            moveUpgradeName = "HideBot";
-                            hidesLeft = 3; // Give 3 hides
-                            cout << name << " upgraded to HideBot." << endl;
+                            applyUpgrade(UP_HIDEBOT);
+                            setHidesLeft(3); // Give 3 hides
+                            emitEvent(EV_UPGRADED, this, UP_HIDEBOT);
                         }
                         break;
                     }
                     case 2: {  // Shooting upgrade
-                        upgradedShooting = true;
-                        int choice = rand() % 6; // 6 shooter types
+                        int choice = gameRand() % 6; // 6 shooter types
                         if (choice == 0) {
-                            shootingUpgradeName = "LongShotBot";
-                            cout << name << " upgraded to LongShotBot." << endl;
+                            applyUpgrade(UP_LONGSHOTBOT);
+                            emitEvent(EV_UPGRADED, this, UP_LONGSHOTBOT);
                         } else if (choice == 1) {
-                            shootingUpgradeName = "SemiAutoBot";
-                            cout << name << " upgraded to SemiAutoBot." << endl;
+                            applyUpgrade(UP_SEMIAUTOBOT);
+                            emitEvent(EV_UPGRADED, this, UP_SEMIAUTOBOT);
                         } else if (choice == 2) {
-                            shootingUpgradeName = "ThirtyShotBot";
-                            shells = 30;  //
-                            cout << name << " upgraded to ThirtyShotBot." << endl;
+                            applyUpgrade(UP_THIRTYSHOTBOT);
+                            setShells(30);  //
+                            emitEvent(EV_UPGRADED, this, UP_THIRTYSHOTBOT);
                         } else if (choice == 3) {
-                            shootingUpgradeName = "PlusShooter";
-                            cout << name << " upgraded to PlusShooter." << endl;
+                            applyUpgrade(UP_PLUSSHOOTER);
+                            emitEvent(EV_UPGRADED, this, UP_PLUSSHOOTER);
                         } else if (choice == 4) {
-                            shootingUpgradeName = "CrossShooter";
-                            cout << name << " upgraded to CrossShooter." << endl;
+                            applyUpgrade(UP_CROSSSHOOTER);
+                            emitEvent(EV_UPGRADED, this, UP_CROSSSHOOTER);
                         } else {
-                            shootingUpgradeName = "DoubleRowShooter";
-                            cout << name << " upgraded to DoubleRowShooter." << endl;
+                            applyUpgrade(UP_DOUBLEROWSHOOTER);
+                            emitEvent(EV_UPGRADED, this, UP_DOUBLEROWSHOOTER);
                         }
                         break;
                     }
                     case 3: {  // Vision upgrade
-                        upgradedSeeing = true;
-                        if (rand() % 2 == 0) { // 50/50 choice
-                            seeingUpgradeName = "ScoutBot";
-                            scansLeft = 3; // 3 scans
-                            cout << name << " upgraded to ScoutBot." << endl;
+                        if (gameRand() % 2 == 0) { // 50/50 choice
+                            applyUpgrade(UP_SCOUTBOT);
+                            setScansLeft(3); // 3 scans
+                            emitEvent(EV_UPGRADED, this, UP_SCOUTBOT);
                         } else {
-                            seeingUpgradeName = "TrackBot";
-                            cout << name << " upgraded to TrackBot." << endl;
+                            applyUpgrade(UP_TRACKBOT);
+                            emitEvent(EV_UPGRADED, this, UP_TRACKBOT);
                         }
                         break;
                     }
@@ -567,59 +999,59 @@ public:
         }
     }
 
+    // Jump next to the closest seen enemy; false if there is no free spot
+    bool jumpNearClosest(int width, int height) {
+        Robot* closest = nullptr;
+        int minDist = INT_MAX;
+        int currentX = getX();
+        int currentY = getY();
+        // Find closest enemy
+        for (Robot* t : seenTargets) {
+            if (!t->isAlive()) continue;
+            int dist = abs(t->getX() - currentX) + abs(t->getY() - currentY); 
+            if (dist < minDist) {
+                minDist = dist;
+                closest = t;
+            }
+        }
+
+        if (closest) {
+            // Find empty spots near target
+            vector<pair<int, int>> options;
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    if (dx == 0 && dy == 0) continue; // Skip target's position
+                    int nx = closest->getX() + dx, ny = closest->getY() + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue; // Boundary check
+                    bool occ = activeNeighbours->occupied(nx, ny); //Occupied flag
+                    if (!occ) options.push_back({nx, ny}); // Valid landing spot
+                }
+            }
+
+            if (!options.empty()) {
+                auto [x_new, y_new] = options[gameRand() % options.size()]; // Pick random spot
+                setPosition(x_new, y_new);
+                setJumpsLeft(jumpsLeft - 1); 
+                emitEvent(EV_JUMPED, this, 0, closest, x_new, y_new);
+                return true;
+            }
+        }
+        return false;
+    }
+
     // Implement MovingRobot's pure virtual function
-    void performMoving(const vector<Robot*>& robots, int width, int height) override {
+    void performMoving(const vector<Robot*>&, int width, int height) override {
         if (!isAlive()) return; //check
 
         // Resets hide status unless still hiding
         if (hidden && !(upgradedMoving && moveUpgradeName == "HideBot" && hidesLeft > 0)) {
-            hidden = false; // Become visible
+            setHidden(false); // Become visible
         }
 
         // JumpBot
         if (upgradedMoving && moveUpgradeName == "JumpBot" &&
-            jumpsLeft > 0 && sawTarget) {
-            Robot* closest = nullptr;
-            int minDist = INT_MAX;
-            int currentX = getX();
-            int currentY = getY();
-            // Find closest enemy
-            for (Robot* t : seenTargets) {
-                if (!t->isAlive()) continue;
-                int dist = abs(t->getX() - currentX) + abs(t->getY() - currentY); 
-                if (dist < minDist) {
-                    minDist = dist;
-                    closest = t;
-                }
-            }
-
-            if (closest) {
-                // Find empty spots near target
-                vector<pair<int, int>> options;
-                for (int dx = -1; dx <= 1; dx++) {
-                    for (int dy = -1; dy <= 1; dy++) {
-                        if (dx == 0 && dy == 0) continue; // Skip target's position
-                        int nx = closest->getX() + dx, ny = closest->getY() + dy;
-                        if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue; // Boundary check
-                        bool occ = false; //Occupied flag
-                        for (auto r : robots) {
-                            if (r->isAlive() && r->getX() == nx && r->getY() == ny) {
-                                occ = true; // Spot occupied
-                                break;
-                            }
-                        }
-                        if (!occ) options.push_back({nx, ny}); // Valid landing spot
-                    }
-                }
-
-                if (!options.empty()) {
-                    auto [x_new, y_new] = options[rand() % options.size()]; // Pick random spot
-                    setPosition(x_new, y_new);
-                    jumpsLeft--; 
-                    cout << name << " jumps to (" << x_new << "," << y_new << ") near " << closest->name << "\n";
-                    return; 
-                }
-            }
+            jumpsLeft > 0 && sawTarget && jumpNearClosest(width, height)) {
+            return;
         }
 
         // Find closest target to move toward
@@ -663,17 +1095,10 @@ public:
 
             // Check if move is valid
             if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                bool occupied = false;
-                for (auto r : robots) {
-                    if (r->isAlive() && r->getX() == nx && r->getY() == ny) {
-                        occupied = true; // Blocked by another bot
-                        break;
-                    }
-                }
+                bool occupied = activeNeighbours->occupied(nx, ny); // Blocked by another bot?
                 if (!occupied) {
                     setPosition(nx, ny);
-                    cout << name << " moves toward " << target->name
-                         << " to (" << nx << "," << ny << ")\n";
+                    emitEvent(EV_MOVED, this, MOVE_TOWARD, target, nx, ny);
                     return; 
                 }
             }
@@ -686,21 +1111,14 @@ public:
                 if (dx == 0 && dy == 0) continue; // Skip staying put
                 int nx = currentX + dx, ny = currentY + dy;
                 if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue; // Map bounds
-                bool occ = false;
-                for (auto r : robots) {
-                    if (r->isAlive() && r->getX() == nx && r->getY() == ny) {
-                        occ = true; // Spot taken
-                        break;
-                    }
-                }
+                bool occ = activeNeighbours->occupied(nx, ny); // Spot taken?
                 if (!occ) options.push_back({nx, ny}); // Valid move
             }
         }
         if (!options.empty()) {
-            auto [nx, ny] = options[rand() % options.size()]; // Pick random move
+            auto [nx, ny] = options[gameRand() % options.size()]; // Pick random move
             setPosition(nx, ny);
-            cout << name << " moves to (" << nx << "," << ny << ")\n";
-            cout << endl;
+            emitEvent(EV_MOVED, this, MOVE_WANDER, nullptr, nx, ny);
         }
     }
 };
@@ -719,10 +1137,9 @@ public:
     // Override think for HideBot logic
     void think(const vector<Robot*>& robots, int width, int height) override {
         if (hidesLeft > 0) {
-            cout << name << " (HideBot) is hidden this turn ("
-                 << hidesLeft << " hides left)\n";
-            hidden = true; // Activate cloak
-            hidesLeft--; // Use one hide
+            emitEvent(EV_HIDDEN, this, HIDE_HIDEBOT, nullptr, getX(), getY(), hidesLeft);
+            setHidden(true); // Activate cloak
+            setHidesLeft(hidesLeft - 1); // Use one hide
             
             // Still looks and shoot while hidden
             look(robots);
@@ -832,178 +1249,3696 @@ public:
     }
 };
 
-// Main game function
-int main() {
-    ofstream logfile("log.txt"); // Create log file
-    streambuf* originalCout = cout.rdbuf(); // Save original cout
+// SCRIPTED ROBOTS
+// A robot whose turn is a small program instead of a C++ subclass. Scripts
+// are text files (one instruction per line, "label:" marks, ';' comments)
+// loaded once and shared by every robot that uses them. Eight registers
+// r0-r7 keep their values between turns. Each turn runs from the top until
+// "end" or until SCRIPT_BUDGET instructions have been spent.
+//
+//   set rA n     rA = n              mov rA rB       rA = rB
+//   add rA rB rC rA = rB + rC        sub rA rB rC    rA = rB - rC
+//   addi rA n    rA += n             rand rA n       rA = random 0..n-1
+//   jmp L        jz rA L             jnz rA L        jlt rA rB L (if rA < rB)
+//   stat rA n    rA = 0 health, 1 shells, 2 lives, 3 x, 4 y, 5 width,
+//                6 height, 7 jumps left, 8 hides left, 9 kills
+//   look rA      normal seeing; rA = number of robots seen
+//   nearest rD rX rY  closest seen robot: distance (or -1) and offset
+//   fire         shoot with the robot's current weapon (and earn upgrades)
+//   move rX rY   step one cell in the direction of (rX, rY) if free
+//   chase        GenericRobot's own move (toward a target or wander)
+//   jump rA      jump next to the closest seen robot; rA = 1 if jumped
+//   hide rA      use a hide if any are left; rA = 1 if hidden
+//   end
+const int SCRIPT_BUDGET = 1000; // instructions per turn
+const int SCRIPT_REGISTERS = 8;
 
-    // Dual output (console + log file)
-    streambuf* logbuf = logfile.rdbuf();
-    class DualBuf : public streambuf {
-        streambuf *buf1, *buf2; // Two output buffers
-    public:
-        DualBuf(streambuf* b1, streambuf* b2) : buf1(b1), buf2(b2) {}
-        int overflow(int c) override {
-            if (c == EOF) return !EOF;
-            if (buf1) buf1->sputc(c); // Send to first buffer (console)
-            if (buf2) buf2->sputc(c); // Send to second buffer (log file)
-            return c;
-        }
-    } dualbuf(originalCout, logbuf);
-    
-    cout.rdbuf(&dualbuf); // Redirect cout to dual output
-    
-    // Read game setup
-    ifstream setup("setup.txt");
-    if (!setup) {
-        cerr << "Failed to open setup.txt" << endl;
-        return 1;
-    }
+enum ScriptOp {
+    OP_END, OP_SET, OP_MOV, OP_ADD, OP_SUB, OP_ADDI, OP_RAND,
+    OP_JMP, OP_JZ, OP_JNZ, OP_JLT, OP_STAT,
+    OP_LOOK, OP_NEAREST, OP_FIRE, OP_MOVE, OP_CHASE, OP_JUMP, OP_HIDE, OP_COUNT
+};
 
-    // Default game settings
-    int width = 10, height = 10, numTurns = 100, numRobots = 0;
-    string line;
-    while (getline(setup, line)) {
-        if (line.find("M by N") != string::npos) {
-            sscanf(line.c_str(), "M by N : %d %d", &width, &height); // Read map size
-        } else if (line.find("steps") != string::npos) {
-            sscanf(line.c_str(), "steps: %d", &numTurns); // Read max turns
-        } else if (line.find("robots") != string::npos) {
-            sscanf(line.c_str(), "robots: %d", &numRobots); // Read robot count
-            break;
-        }
+// Mnemonic and operands: r = register, n = number, l = label
+const struct { const char* name; const char* operands; } SCRIPT_OPS[OP_COUNT] = {
+    { "end", "" }, { "set", "rn" }, { "mov", "rr" }, { "add", "rrr" }, { "sub", "rrr" },
+    { "addi", "rn" }, { "rand", "rn" }, { "jmp", "l" }, { "jz", "rl" }, { "jnz", "rl" },
+    { "jlt", "rrl" }, { "stat", "rn" }, { "look", "r" }, { "nearest", "rrr" }, { "fire", "" },
+    { "move", "rr" }, { "chase", "" }, { "jump", "r" }, { "hide", "r" }
+};
+
+struct ScriptInsn {
+    const void* handler; // address of the op's code in ScriptBot::run (direct threading)
+    int op;
+    int a, b, c;
+};
+
+struct ScriptProgram {
+    string path;
+    vector<ScriptInsn> code; // always ends with "end"
+};
+
+class ScriptBot : public GenericRobot {
+public:
+    const ScriptProgram* program;
+    int regs[SCRIPT_REGISTERS] = {};
+
+    ScriptBot(const ScriptProgram* p, string n, char s, int x, int y, int hp, int ammo, int l)
+        : GenericRobot(n, s, x, y, hp, ammo, l), program(p) {}
+
+    void think(const vector<Robot*>& robots, int width, int height) override {
+        if (hidden) setHidden(false); // A hide only lasts until our next turn
+        emitEvent(EV_THINKING, this);
+        // Sightings only come from this turn's look
+        seenTargets.clear();
+        sawTarget = false;
+        run(this, robots, width, height);
     }
 
-    // Create robots
-    vector<Robot*> robots, respawnQueue;
-    char nextSymbol = 'A'; // Starting map symbol
-    for (int i = 0; i < numRobots; ++i) {
-        string type, name;
-        string xs, ys;
-        setup >> type >> name >> xs >> ys; // Read robot config
-        
-        // Handling random positions
-        int x = (xs == "random") ? rand() % width : stoi(xs);
-        int y = (ys == "random") ? rand() % height : stoi(ys);
+    // Runs one turn of the bot's program. Called with bot == nullptr it only
+    // hands back the handler table, which the loader copies into each
+    // instruction so dispatch is a single indirect jump.
+    static const void* const* run(ScriptBot* bot, const vector<Robot*>& robots, int width, int height) {
+        static const void* const handlers[OP_COUNT] = {
+            &&op_end, &&op_set, &&op_mov, &&op_add, &&op_sub, &&op_addi, &&op_rand,
+            &&op_jmp, &&op_jz, &&op_jnz, &&op_jlt, &&op_stat,
+            &&op_look, &&op_nearest, &&op_fire, &&op_move, &&op_chase, &&op_jump, &&op_hide
+        };
+        if (!bot) return handlers;
 
-        int lives = 2; // Default lives, 3?
+        const ScriptInsn* code = bot->program->code.data();
+        const ScriptInsn* ip = code;
+        int* r = bot->regs;
+        int budget = SCRIPT_BUDGET;
+#define SCRIPT_DISPATCH() do { if (--budget < 0) return handlers; goto *ip->handler; } while (0)
+#define SCRIPT_NEXT() do { ++ip; SCRIPT_DISPATCH(); } while (0)
+#define SCRIPT_GOTO(target) do { ip = code + (target); SCRIPT_DISPATCH(); } while (0)
+        SCRIPT_DISPATCH();
 
-        // Create robot based on type
-        if (type == "GenericRobot") {
-            robots.push_back(new GenericRobot(name, nextSymbol++, x, y, 1, 10, lives));
-        }
-        else if (type == "HideBot") {
-            robots.push_back(new HideBot(name, nextSymbol++, x, y, 1, 10, lives));
-        }
-        else if (type == "JumpBot") {
-            robots.push_back(new JumpBot(name, nextSymbol++, x, y, 1, 10, lives));
+    op_end:
+        return handlers;
+    op_set:
+        r[ip->a] = ip->b;
+        SCRIPT_NEXT();
+    op_mov:
+        r[ip->a] = r[ip->b];
+        SCRIPT_NEXT();
+    op_add:
+        r[ip->a] = r[ip->b] + r[ip->c];
+        SCRIPT_NEXT();
+    op_sub:
+        r[ip->a] = r[ip->b] - r[ip->c];
+        SCRIPT_NEXT();
+    op_addi:
+        r[ip->a] += ip->b;
+        SCRIPT_NEXT();
+    op_rand:
+        r[ip->a] = ip->b > 0 ? (int)(gameRand() % ip->b) : 0;
+        SCRIPT_NEXT();
+    op_jmp:
+        SCRIPT_GOTO(ip->a);
+    op_jz:
+        if (r[ip->a] == 0) SCRIPT_GOTO(ip->b);
+        SCRIPT_NEXT();
+    op_jnz:
+        if (r[ip->a] != 0) SCRIPT_GOTO(ip->b);
+        SCRIPT_NEXT();
+    op_jlt:
+        if (r[ip->a] < r[ip->b]) SCRIPT_GOTO(ip->c);
+        SCRIPT_NEXT();
+    op_stat:
+        switch (ip->b) {
+            case 0: r[ip->a] = bot->health; break;
+            case 1: r[ip->a] = bot->shells; break;
+            case 2: r[ip->a] = bot->lives; break;
+            case 3: r[ip->a] = bot->getX(); break;
+            case 4: r[ip->a] = bot->getY(); break;
+            case 5: r[ip->a] = width; break;
+            case 6: r[ip->a] = height; break;
+            case 7: r[ip->a] = bot->jumpsLeft; break;
+            case 8: r[ip->a] = bot->hidesLeft; break;
+            case 9: r[ip->a] = bot->kills; break;
+            default: r[ip->a] = 0; break;
         }
-        else if (type == "LongShotBot") {
-            robots.push_back(new LongShotBot(name, nextSymbol++, x, y, 1, 10, lives));
+        SCRIPT_NEXT();
+    op_look:
+        bot->performSeeing(robots);
+        r[ip->a] = (int)bot->seenTargets.size();
+        SCRIPT_NEXT();
+    op_nearest: {
+        int best = -1, bestX = 0, bestY = 0;
+        for (Robot* t : bot->seenTargets) {
+            if (!t->isAlive()) continue;
+            int dx = t->getX() - bot->getX(), dy = t->getY() - bot->getY();
+            int dist = abs(dx) + abs(dy);
+            if (best < 0 || dist < best) { best = dist; bestX = dx; bestY = dy; }
         }
-        else if (type == "SemiAutoBot") {
-            robots.push_back(new SemiAutoBot(name, nextSymbol++, x, y, 1, 10, lives));
-        }
-        else if (type == "ThirtyShotBot") {
-            robots.push_back(new ThirtyShotBot(name, nextSymbol++, x, y, 1, 10, lives));
+        r[ip->a] = best;
+        r[ip->b] = bestX;
+        r[ip->c] = bestY;
+        SCRIPT_NEXT();
+    }
+    op_fire:
+        bot->performShooting(const_cast<vector<Robot*>&>(robots));
+        if (!bot->isAlive()) return handlers; // Ran out of shells
+        SCRIPT_NEXT();
+    op_move: {
+        int nx = bot->getX() + (r[ip->a] > 0) - (r[ip->a] < 0);
+        int ny = bot->getY() + (r[ip->b] > 0) - (r[ip->b] < 0);
+        if ((nx != bot->getX() || ny != bot->getY()) && nx >= 0 && ny >= 0 && nx < width && ny < height &&
+            !activeNeighbours->occupied(nx, ny)) {
+            bot->setPosition(nx, ny);
+            emitEvent(EV_MOVED, bot, MOVE_WANDER, nullptr, nx, ny);
         }
-        else if (type == "ScoutBot") {
-            robots.push_back(new ScoutBot(name, nextSymbol++, x, y, 1, 10, lives));
+        SCRIPT_NEXT();
+    }
+    op_chase:
+        bot->performMoving(robots, width, height);
+        SCRIPT_NEXT();
+    op_jump:
+        r[ip->a] = bot->jumpsLeft > 0 && bot->jumpNearClosest(width, height);
+        SCRIPT_NEXT();
+    op_hide:
+        r[ip->a] = bot->hidesLeft > 0;
+        if (r[ip->a]) {
+            emitEvent(EV_HIDDEN, bot, HIDE_UPGRADE);
+            bot->setHidden(true);
+            bot->setHidesLeft(bot->hidesLeft - 1);
         }
-        else if (type == "TrackBot") {
-            robots.push_back(new TrackBot(name, nextSymbol++, x, y, 1, 10, lives));
+        SCRIPT_NEXT();
+#undef SCRIPT_DISPATCH
+#undef SCRIPT_NEXT
+#undef SCRIPT_GOTO
+    }
+};
+
+// Parse a script file; on failure error says "file:line: what"
+bool parseScript(const string& path, ScriptProgram& program, string& error) {
+    ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct PendingLabel { size_t insn; int operand; string label; int line; };
+    map<string, int> labels;
+    vector<PendingLabel> pending;
+    program.path = path;
+    program.code.clear();
+
+    string line;
+    for (int lineNo = 1; getline(in, line); ++lineNo) {
+        auto fail = [&](const string& what) {
+            error = path + ":" + to_string(lineNo) + ": " + what;
+            return false;
+        };
+        line = line.substr(0, line.find_first_of(";#"));
+        for (char& ch : line) {
+            if (ch == ',') ch = ' ';
         }
-        else if (type == "PlusShooter") {
-            robots.push_back(new PlusShooter(name, nextSymbol++, x, y, 1, 10, lives));
+        istringstream words(line);
+        string word;
+        if (!(words >> word)) continue;
+        if (word.back() == ':') { // Label, maybe followed by an instruction
+            word.pop_back();
+            if (labels.count(word)) return fail("duplicate label " + word);
+            labels[word] = (int)program.code.size();
+            if (!(words >> word)) continue;
         }
-        else if (type == "CrossShooter") {
-            robots.push_back(new CrossShooter(name, nextSymbol++, x, y, 1, 10, lives));
+        int op = 0;
+        while (op < OP_COUNT && word != SCRIPT_OPS[op].name) op++;
+        if (op == OP_COUNT) return fail("unknown instruction " + word);
+
+        ScriptInsn insn = { nullptr, op, 0, 0, 0 };
+        int* operands[] = { &insn.a, &insn.b, &insn.c };
+        const char* kinds = SCRIPT_OPS[op].operands;
+        for (int k = 0; kinds[k]; ++k) {
+            string arg;
+            if (!(words >> arg)) return fail(word + " needs " + to_string(strlen(kinds)) + " operands");
+            if (kinds[k] == 'r') {
+                if (arg.size() != 2 || arg[0] != 'r' || arg[1] < '0' || arg[1] >= '0' + SCRIPT_REGISTERS) {
+                    return fail("bad register " + arg);
+                }
+                *operands[k] = arg[1] - '0';
+            } else if (kinds[k] == 'n') {
+                char* end;
+                long value = strtol(arg.c_str(), &end, 10);
+                if (*end || arg.empty()) return fail("bad number " + arg);
+                *operands[k] = (int)value;
+            } else {
+                pending.push_back({ program.code.size(), k, arg, lineNo });
+            }
         }
-        else if (type == "DoubleRowShooter") {
-            robots.push_back(new DoubleRowShooter(name, nextSymbol++, x, y, 1, 10, lives));
+        if (words >> word) return fail("too many operands");
+        program.code.push_back(insn);
+    }
+    program.code.push_back({ nullptr, OP_END, 0, 0, 0 }); // Running off the end stops the turn
+
+    for (const PendingLabel& p : pending) {
+        auto it = labels.find(p.label);
+        if (it == labels.end()) {
+            error = path + ":" + to_string(p.line) + ": unknown label " + p.label;
+            return false;
         }
+        ScriptInsn& insn = program.code[p.insn];
+        (p.operand == 0 ? insn.a : p.operand == 1 ? insn.b : insn.c) = it->second;
     }
-    setup.close();
 
-    srand((unsigned)time(0)); // Seed random generator
+    // Thread the code: store each op's handler address in the instruction
+    const void* const* handlers = ScriptBot::run(nullptr, {}, 0, 0);
+    for (ScriptInsn& insn : program.code) insn.handler = handlers[insn.op];
+    return true;
+}
 
-    // Main game loop
-    int turn = 1;
-    while (turn <= numTurns) {
-        int aliveCount = count_if(robots.begin(), robots.end(), [](Robot* r) { return r->isAlive(); });
-        if (aliveCount <= 1 && respawnQueue.empty()) break; // Stop if only 1 bot left
+// Scripts are parsed once per path and then shared (setups are read by many
+// threads in batch and server modes)
+const ScriptProgram* loadScript(const string& path) {
+    static map<string, ScriptProgram> cache;
+    static mutex cacheMutex;
+    lock_guard<mutex> lock(cacheMutex);
+    auto it = cache.find(path);
+    if (it != cache.end()) return &it->second;
+    ScriptProgram program;
+    string error;
+    if (!parseScript(path, program, error)) {
+        cerr << "Script error: " << error << endl;
+        return nullptr;
+    }
+    return &(cache[path] = move(program));
+}
 
-        cout << "----- Turn " << turn << " -----" << endl;
+// LOOKAHEAD
+// A small model of a robot's surroundings for trying moves out before making
+// them. World keeps plain records of the nearby robots behind a shared
+// pointer, so copying a World is O(1): the copy shares the records until
+// its first write, which gives it a private set (copy-on-write). Each World
+// rolls its own dice, so simulating never touches the game's random stream.
+// rollback() returns to an earlier copy, reusing records it already owns.
+struct WorldBody {
+    int x, y;
+    int health;
+    bool alive, hidden;
+    int reach; // Manhattan firing range (3 for LongShotBot, else adjacent)
+    int shots; // shots per turn (3 for SemiAutoBot)
+};
 
-        // Draw battle map
-        cout << string(width * 2 + 2, '*') << endl; // Top border
-        
-        for (int y = 0; y < height; ++y) {
-            cout << '*'; // Left border
-            for (int x = 0; x < width; ++x) {
-                char cell = '.'; // Empty space
-                // Check for robots at this position
-                for (auto* r : robots) {
-                    if (r->isAlive() && !r->hidden && r->getX() == x && r->getY() == y) {
-                        cell = r->symbol; // Robot letter
-                        break;
-                    }
-                }
-                cout << cell << " "; // Print cell
-            }
-            cout << '*' << endl; // Right border
+class World {
+public:
+    int width = 0, height = 0;
+    unsigned rng = 1;
+    int kills = 0; // enemies destroyed by body 0, the robot doing the thinking
+
+    World() : bodies(make_shared<vector<WorldBody>>()) {}
+
+    int size() const { return (int)bodies->size(); }
+    const WorldBody& at(int i) const { return (*bodies)[i]; }
+
+    WorldBody& edit(int i) {
+        own();
+        return (*bodies)[i];
+    }
+
+    void add(const WorldBody& body) {
+        own();
+        bodies->push_back(body);
+    }
+
+    // Go back to a saved copy. Records we own are overwritten in place, so a
+    // loop of playouts from the same start only allocates once.
+    void rollback(const World& saved) {
+        width = saved.width;
+        height = saved.height;
+        rng = saved.rng;
+        kills = saved.kills;
+        if (bodies != saved.bodies && bodies.use_count() == 1) *bodies = *saved.bodies;
+        else bodies = saved.bodies;
+    }
+
+    int roll(int n) { return (int)(nextRand(rng) & 0x7fffffff) % n; }
+
+    bool freeCell(int x, int y) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return false;
+        for (const WorldBody& b : *bodies) {
+            if (b.alive && b.x == x && b.y == y) return false;
         }
-        
-        // Bottom border
-        cout << string(width * 2 + 2, '*') << endl;
+        return true;
+    }
 
-        // Respawn dead robots
-        if (!respawnQueue.empty()) {
-            Robot* r = respawnQueue.front();
-            respawnQueue.erase(respawnQueue.begin());
-            int nx, ny;
-            // Find empty spot
-            do {
-                nx = rand() % width;
-                ny = rand() % height;
-                bool occ = false;
-                for (auto* other : robots) {
-                    if (other->isAlive() && other->getX() == nx && other->getY() == ny) {
-                        occ = true; break;
-                    }
-                }
-                if (!occ) break;
-            } while (true);
-            r->respawn(nx, ny); 
+    // Body i shoots body j; true if j was destroyed
+    bool shoot(int i, int j) {
+        for (int s = 0; s < at(i).shots && at(j).alive; ++s) {
+            if (roll(100) >= 70) continue; // Same 70% as the engine
+            WorldBody& target = edit(j);
+            if (--target.health <= 0) target.alive = false;
         }
+        return !at(j).alive;
+    }
 
-        // Process each robot's turn
-        for (Robot* r : robots) {
-            if (!r->isAlive()) continue; // Skip dead bots
-            r->think(robots, width, height); // AI thinking
+    void step(int i, int dx, int dy) {
+        int nx = at(i).x + dx, ny = at(i).y + dy;
+        if ((dx || dy) && freeCell(nx, ny)) {
+            WorldBody& b = edit(i);
+            b.x = nx;
+            b.y = ny;
+        }
+    }
+
+    void wander(int i) {
+        int dir = roll(8);
+        if (dir >= 4) dir++; // 0..8 without the middle (4)
+        step(i, dir % 3 - 1, dir / 3 - 1);
+    }
+
+    // Every other body takes a turn against body 0: shoot if in reach, then
+    // close in if it can see it, otherwise wander
+    void enemiesAct() {
+        for (int i = 1; i < size(); ++i) {
+            if (!at(i).alive) continue;
+            const WorldBody& me = at(0);
+            int dx = me.x - at(i).x, dy = me.y - at(i).y;
+            bool adjacent = abs(dx) <= 1 && abs(dy) <= 1;
+            bool inReach = at(i).reach > 1 ? abs(dx) + abs(dy) <= at(i).reach : adjacent;
+            if (me.alive && !me.hidden && inReach) shoot(i, 0);
+            if (adjacent && me.alive) step(i, (dx > 0) - (dx < 0), (dy > 0) - (dy < 0));
+            else wander(i);
+        }
+    }
+
+    // Body 0's default play in later plies: shoot something adjacent, then wander
+    void selfActs() {
+        for (int i = 1; i < size(); ++i) {
+            if (at(i).alive && !at(i).hidden && abs(at(i).x - at(0).x) <= 1 && abs(at(i).y - at(0).y) <= 1) {
+                if (shoot(0, i)) kills++;
+                break;
+            }
+        }
+        wander(0);
+    }
+
+private:
+    shared_ptr<vector<WorldBody>> bodies;
+
+    // First write to shared records: take a private copy
+    void own() {
+        if (bodies.use_count() > 1) bodies = make_shared<vector<WorldBody>>(*bodies);
+    }
+};
+
+const int LOOKAHEAD_RADIUS = 4;   // robots further than this are left out of the model
+const int LOOKAHEAD_PLIES = 2;    // turns simulated after each candidate step
+const int LOOKAHEAD_ROLLOUTS = 8; // random playouts per candidate
+
+// Shoots like GenericRobot, but with other robots nearby it picks its step by
+// trying every free neighbouring cell (or staying put) in a few simulated
+// playouts and taking the one where it most often survives, with a bonus
+// for kills. With nobody nearby it moves like GenericRobot.
+class LookaheadBot : public GenericRobot {
+public:
+    LookaheadBot(string n, char s, int x, int y, int hp, int ammo, int l)
+        : GenericRobot(n, s, x, y, hp, ammo, l) {}
+
+    void think(const vector<Robot*>& robots, int width, int height) override {
+        if (upgradedMoving && moveUpgradeName == "HideBot" && hidesLeft > 0) {
+            emitEvent(EV_HIDDEN, this, HIDE_UPGRADE);
+            setHidden(true);
+            setHidesLeft(hidesLeft - 1);
+        } else {
+            emitEvent(EV_THINKING, this);
+        }
+        performSeeing(robots);
+        if (sawTarget) performShooting(const_cast<vector<Robot*>&>(robots));
+        if (!isAlive()) return;
+
+        World base = snapshot(robots, width, height), scratch = base;
+        if (base.size() == 1) { // Nobody near enough to matter: move like GenericRobot
+            performMoving(robots, width, height);
+            return;
+        }
+        if (hidden && !(upgradedMoving && moveUpgradeName == "HideBot" && hidesLeft > 0)) setHidden(false);
+        unsigned turnSeed = gameRand(); // One draw from the game; playouts use their own dice
+        int bestX = getX(), bestY = getY();
+        double bestScore = evaluate(base, scratch, 0, 0, turnSeed);
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if ((dx == 0 && dy == 0) || !base.freeCell(getX() + dx, getY() + dy)) continue;
+                double score = evaluate(base, scratch, dx, dy, turnSeed);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestX = getX() + dx;
+                    bestY = getY() + dy;
+                }
+            }
+        }
+        if (bestX != getX() || bestY != getY()) {
+            setPosition(bestX, bestY);
+            emitEvent(EV_MOVED, this, MOVE_WANDER, nullptr, bestX, bestY);
+        }
+    }
+
+private:
+    // Body 0 is this robot, then every living robot within LOOKAHEAD_RADIUS
+    World snapshot(const vector<Robot*>& robots, int width, int height) const {
+        World world;
+        world.width = width;
+        world.height = height;
+        auto body = [](const Robot* r) {
+            return WorldBody{ r->getX(), r->getY(), r->health, true, r->hidden,
+                              r->shootingUpgradeName == "LongShotBot" ? 3 : 1,
+                              r->shootingUpgradeName == "SemiAutoBot" ? 3 : 1 };
+        };
+        world.add(body(this));
+        for (const Robot* r : robots) {
+            if (r == this || !r->isAlive()) continue;
+            if (abs(r->getX() - getX()) > LOOKAHEAD_RADIUS || abs(r->getY() - getY()) > LOOKAHEAD_RADIUS) continue;
+            world.add(body(r));
+        }
+        return world;
+    }
+
+    // Average playout score for stepping by (dx, dy). Playout k uses the same
+    // dice for every candidate, so candidates are compared on equal luck.
+    double evaluate(const World& base, World& world, int dx, int dy, unsigned turnSeed) const {
+        double total = 0;
+        for (int k = 0; k < LOOKAHEAD_ROLLOUTS; ++k) {
+            world.rollback(base);
+            world.rng = mixSeed(turnSeed * 31 + k);
+            world.step(0, dx, dy);
+            world.enemiesAct();
+            for (int ply = 1; ply < LOOKAHEAD_PLIES && world.at(0).alive; ++ply) {
+                world.selfActs();
+                world.enemiesAct();
+            }
+            total += (world.at(0).alive ? 1.0 : 0.0) + 0.25 * world.kills;
+        }
+        return total / LOOKAHEAD_ROLLOUTS;
+    }
+};
+
+// Parsed setup.txt contents
+struct RobotEntry {
+    string type, name;
+    string xs, ys; // "random" or a number
+};
+
+struct GameSetup {
+    int width = 10, height = 10, numTurns = 100;
+    bool hasSeed = false; // optional "seed: N" line
+    unsigned seed = 0;
+    int stalemateTurns = 0; // optional "stalemate: K" line, 0 = play every turn
+    vector<RobotEntry> entries;
+};
+
+// Reads the "M by N / steps / robots" header and robot lines
+void readSetup(istream& in, GameSetup& config) {
+    int numRobots = 0;
+    string line;
+    while (getline(in, line)) {
+        if (line.find("M by N") != string::npos) {
+            sscanf(line.c_str(), "M by N : %d %d", &config.width, &config.height); // Read map size
+        } else if (line.find("steps") != string::npos) {
+            sscanf(line.c_str(), "steps: %d", &config.numTurns); // Read max turns
+        } else if (line.find("stalemate") != string::npos) {
+            sscanf(line.c_str(), "stalemate: %d", &config.stalemateTurns); // Quiet turns before giving up
+        } else if (line.find("seed") != string::npos) {
+            config.hasSeed = sscanf(line.c_str(), "seed: %u", &config.seed) == 1; // Fixed random seed
+        } else if (line.find("robots") != string::npos) {
+            sscanf(line.c_str(), "robots: %d", &numRobots); // Read robot count
+            break;
+        }
+    }
+    for (int i = 0; i < numRobots; ++i) {
+        RobotEntry entry;
+        if (!(in >> entry.type >> entry.name >> entry.xs >> entry.ys)) break; // Read robot config
+        config.entries.push_back(entry);
+    }
+}
+
+// Largest map side and robot count a setup may ask for
+const int MAX_SETUP_SIDE = 10000;
+const int MAX_SETUP_ROBOTS = 10000;
+
+// "random" or a whole number in [0, limit)
+bool validCoordinate(const string& text, int limit) {
+    if (text == "random") return true;
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long value = strtol(text.c_str(), &end, 10);
+    return errno == 0 && *end == '\0' && value >= 0 && value < limit;
+}
+
+// True if Game::setup can safely build this setup
+bool validSetup(const GameSetup& config) {
+    if (config.width <= 0 || config.height <= 0) return false;
+    if (config.width > MAX_SETUP_SIDE || config.height > MAX_SETUP_SIDE) return false;
+    if (config.entries.size() > (size_t)MAX_SETUP_ROBOTS) return false;
+    for (const RobotEntry& entry : config.entries) {
+        if (!validCoordinate(entry.xs, config.width) || !validCoordinate(entry.ys, config.height)) return false;
+    }
+    return true;
+}
+
+// Setup types ending in ".bot" name a script file
+bool isScriptType(const string& type) {
+    return type.size() > 4 && type.compare(type.size() - 4, 4, ".bot") == 0;
+}
+
+// Create a robot from its setup.txt type name (nullptr if unknown)
+Robot* makeRobot(const string& type, const string& name, char symbol, int x, int y) {
+    int lives = 2; // Default lives, 3?
+    if (type == "GenericRobot") return new GenericRobot(name, symbol, x, y, 1, 10, lives);
+    if (type == "HideBot") return new HideBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "JumpBot") return new JumpBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "LongShotBot") return new LongShotBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "SemiAutoBot") return new SemiAutoBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "ThirtyShotBot") return new ThirtyShotBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "ScoutBot") return new ScoutBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "TrackBot") return new TrackBot(name, symbol, x, y, 1, 10, lives);
+    if (type == "PlusShooter") return new PlusShooter(name, symbol, x, y, 1, 10, lives);
+    if (type == "CrossShooter") return new CrossShooter(name, symbol, x, y, 1, 10, lives);
+    if (type == "DoubleRowShooter") return new DoubleRowShooter(name, symbol, x, y, 1, 10, lives);
+    if (type == "LookaheadBot") return new LookaheadBot(name, symbol, x, y, 1, 10, lives);
+    if (isScriptType(type)) {
+        const ScriptProgram* program = loadScript(type);
+        if (program) return new ScriptBot(program, name, symbol, x, y, 1, 10, lives);
+    }
+    return nullptr;
+}
+
+// One arena: map, robots and the turn loop. An arena can be set up again
+// and reused for any number of games.
+class Game {
+public:
+    int width = 10, height = 10, numTurns = 100;
+    int turn = 1;
+    vector<Robot*> robots, respawnQueue;
+    unsigned rngState = 1; // this game's random generator
+    unsigned long long hash = 0; // Zobrist hash of the current state
+    EventBus bus;          // sinks listening to this game
+    Heatmap* heat = nullptr; // counters to fill (heatmap builds only)
+    NeighbourIndex neighbourIndex; // living robots by cell
+    int stalemateTurns = 0; // quiet turns before ending early (0 = never)
+    bool stalemate = false; // ended early because nothing was happening
+
+    Game() {}
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
+    ~Game() { clear(); }
+
+    // Build the robots for a new game
+    void setup(const GameSetup& config, unsigned seed) {
+        clear();
+        width = config.width;
+        height = config.height;
+        numTurns = config.numTurns;
+        stalemateTurns = config.stalemateTurns;
+        stalemate = false;
+        quietTurns = 0;
+        lastActivity = 0;
+        seenStates.clear();
+        turn = 1;
+        rngState = mixSeed(seed);
+        bind();
+
+        char nextSymbol = 'A'; // Starting map symbol
+        for (const RobotEntry& entry : config.entries) {
+            // Handling random positions
+            int x = (entry.xs == "random") ? gameRand() % width : stoi(entry.xs);
+            int y = (entry.ys == "random") ? gameRand() % height : stoi(entry.ys);
+            Robot* r = makeRobot(entry.type, entry.name, nextSymbol, x, y);
+            if (r) {
+                r->id = (int)robots.size();
+                robots.push_back(r);
+                neighbourIndex.add(r);
+                nextSymbol++;
+            }
+        }
+        hash = fullHash();
+    }
+
+    // Stop if only 1 bot left or out of turns
+    bool isOver() const {
+        if (turn > numTurns || stalemate) return true;
+        int aliveCount = count_if(robots.begin(), robots.end(), [](Robot* r) { return r->isAlive(); });
+        return aliveCount <= 1 && respawnQueue.empty();
+    }
+
+    // Play one turn; false once the game is over
+    bool playTurn() {
+        bind();
+        if (isOver()) return false;
+
+        bus.turn = turn;
+        emitEvent(EV_TURN_START, nullptr); // Header and battle map
+
+        // Respawn dead robots
+        if (!respawnQueue.empty()) {
+            Robot* r = respawnQueue.front();
+            respawnQueue.erase(respawnQueue.begin());
+            int nx, ny;
+            // Find empty spot
+            TELEMETRY_SET(inRespawnSearch, 1);
+            do {
+                nx = gameRand() % width;
+                ny = gameRand() % height;
+                TELEMETRY_ADD(respawnTries, 1);
+                if (!neighbourIndex.occupied(nx, ny)) break;
+            } while (true);
+            TELEMETRY_SET(inRespawnSearch, 0);
+            r->respawn(nx, ny); 
+        }
+
+        // Process each robot's turn
+        for (Robot* r : robots) {
+            if (!r->isAlive()) continue; // Skip dead bots
+            r->think(robots, width, height); // AI thinking
         }
 
         // Queue dead robots for respawn
         for (Robot* r : robots) {
             if (!r->isAlive() && r->lives > 0 &&
                 find(respawnQueue.begin(), respawnQueue.end(), r) == respawnQueue.end()) {
-                r->lives--; // Use one life
+                r->setLives(r->lives - 1); // Use one life
                 respawnQueue.push_back(r); // Add to respawn line
             }
+            if (r->isAlive()) HEAT_COUNT(occupancy, r->getX(), r->getY());
         }
 
-        // Print status report
-        cout << "--- Status after Turn " << turn << " ---" << endl;
+        emitEvent(EV_TURN_END, nullptr); // Status report
+        if (stalemateTurns > 0) checkStalemate();
+        turn++;
+        if (TelemetryCounters* t = telemetry()) {
+            bump(t->turns, 1);
+            t->alive.store(count_if(robots.begin(), robots.end(), [](Robot* r) { return r->isAlive(); }), memory_order_relaxed);
+            t->respawnQueue.store(respawnQueue.size(), memory_order_relaxed);
+            t->lastTurnNs.store(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count(),
+                                memory_order_relaxed);
+        }
+        return true;
+    }
+
+    void play() {
+        while (playTurn()) {}
+    }
+
+    // Last robot standing, or nullptr if nobody (or several) survived
+    Robot* survivor() const {
+        Robot* last = nullptr;
         for (Robot* r : robots) {
-            cout << *r << endl; // Use overloaded << operator
+            if (!r->isAlive()) continue;
+            if (last) return nullptr;
+            last = r;
+        }
+        return last;
+    }
+
+    // State hash recomputed from scratch (should always equal hash)
+    unsigned long long fullHash() const {
+        unsigned long long h = 0;
+        for (const Robot* r : robots) h ^= r->zobrist();
+        return h;
+    }
+
+    // Delete robots (respawnQueue only holds pointers into robots)
+    void clear() {
+        for (Robot* r : robots) delete r;
+        robots.clear();
+        respawnQueue.clear();
+        neighbourIndex.clear();
+    }
+
+private:
+    int quietTurns = 0;
+    unsigned long long lastActivity = 0;
+    unordered_set<unsigned long long> seenStates; // since the last activity
+
+    // A turn is quiet if nobody was damaged, destroyed, respawned or
+    // upgraded and nobody saw anyone. stalemateTurns quiet turns in a row,
+    // or the board coming back to a position it had earlier in the quiet
+    // spell, ends the game; the result is scored as at the turn limit.
+    void checkStalemate() {
+        unsigned long long activity = 0;
+        bool sighting = false;
+        for (const Robot* r : robots) {
+            activity = mix64(activity ^ ((unsigned long long)r->health << 40) ^
+                             ((unsigned long long)r->deaths << 20) ^ (unsigned long long)r->upgradeCount);
+            if (r->isAlive() && r->sawTarget) sighting = true;
+        }
+        if (sighting || activity != lastActivity) {
+            lastActivity = activity;
+            quietTurns = 0;
+            seenStates.clear();
+            return;
+        }
+        quietTurns++;
+        // Only the board counts: the dice advance every turn, so with them
+        // in the key no state would ever come round again
+        bool repeated = !seenStates.insert(hash).second;
+        if (quietTurns >= stalemateTurns || repeated) {
+            stalemate = true;
+            emitEvent(EV_STALEMATE, nullptr, repeated ? STALE_REPEAT : STALE_QUIET, nullptr, 0, 0, quietTurns);
+        }
+    }
+
+    // Point this thread's dice and narration at this game
+    void bind() {
+        activeRng = &rngState;
+        activeBus = &bus;
+        activeHash = &hash;
+        activeNeighbours = &neighbourIndex;
+#ifdef ROBOTWAR_HEATMAP
+        activeHeatmap = heat;
+#endif
+    }
+};
+
+// EVENT SINKS
+
+// Text narration, word for word what the game always printed
+class TextNarrator : public EventSink {
+    const Game& game;
+    ostream& out;
+public:
+    TextNarrator(const Game& g, ostream& o) : game(g), out(o) {}
+
+    void onEvent(const Event& e) override {
+        const Robot* a = e.actor;
+        const Robot* t = e.target;
+        switch (e.type) {
+            case EV_TURN_START:
+                out << "----- Turn " << e.turn << " -----\n";
+                drawMap();
+                break;
+            case EV_TURN_END:
+                out << "--- Status after Turn " << e.turn << " ---\n";
+                for (const Robot* r : game.robots) {
+                    out << *r << "\n"; // Use overloaded << operator
+                }
+                out << "\n";
+                break;
+            case EV_THINKING:
+                out << a->name << " is thinking...\n";
+                break;
+            case EV_HIDDEN:
+                if (e.kind == HIDE_UPGRADE) out << a->name << " is hidden and invulnerable this turn.\n";
+                else if (e.kind == HIDE_HIDEBOT) out << a->name << " (HideBot) is hidden this turn (" << e.value << " hides left)\n";
+                else out << a->name << " is hidden, so it takes no damage.\n";
+                break;
+            case EV_TRACKED:
+                out << a->name << " tracked " << e.value << " robots.\n";
+                break;
+            case EV_SCANNED:
+                out << a->name << " uses ScoutBot scan (" << e.value << " left):\n";
+                break;
+            case EV_SAW:
+                out << "  " << a->name << " sees " << t->name << " at (" << e.x << "," << e.y << ")\n";
+                break;
+            case EV_SAW_NOBODY:
+                out << "  " << a->name << " sees no one.\n";
+                break;
+            case EV_FIRED:
+                if (e.kind == W_SEMIAUTO) {
+                    out << a->name << " (SemiAutoBot) fires 3 shots at " << t->name << "! ";
+                } else if (e.kind == W_LONGSHOT) {
+                    out << a->name << " (LongShotBot) fires at " << t->name << " (dist=" << e.value << ")... "
+                        << (e.hit ? "HIT!\n" : "misses.\n");
+                } else if (e.kind == W_DEFAULT) {
+                    out << a->name << " fires at " << t->name << "... " << (e.hit ? "HIT!\n" : "misses.\n");
+                } else {
+                    out << "  Targeting " << t->name << " at (" << e.x << "," << e.y << ")... "
+                        << (e.hit ? "HIT!\n" : "missed.\n");
+                }
+                break;
+            case EV_BURST_DONE:
+                if (e.value > 0) out << "HIT " << e.value << " times!\n";
+                else out << "All shots miss.\n";
+                break;
+            case EV_PATTERN:
+                if (e.kind == W_PLUS) out << a->name << " fires in + pattern!\n";
+                else if (e.kind == W_CROSS) out << a->name << " fires in X pattern!\n";
+                else out << a->name << " fires across two rows!\n";
+                break;
+            case EV_NO_TARGET:
+                if (e.kind == W_LONGSHOT) out << a->name << " (LongShotBot) sees no target within 3-unit range.\n";
+                else if (e.kind == W_PLUS) out << "  No valid targets in + pattern, falling back to regular fire.\n";
+                else if (e.kind == W_CROSS) out << "  No valid targets in X pattern, falling back to regular fire.\n";
+                else if (e.kind == W_DOUBLEROW) out << "  No valid targets in row pattern, falling back to regular fire.\n";
+                else out << a->name << " sees no adjacent target to fire at.\n";
+                break;
+            case EV_HIT:
+                out << "  " << a->name << " is hit! (Health=" << e.value << ")\n";
+                break;
+            case EV_DESTROYED:
+                if (e.kind == DESTROY_SELF) out << a->name << " self-destructs!\n";
+                else out << "  " << a->name << " is destroyed!\n";
+                break;
+            case EV_UPGRADE_EARNED:
+                out << a->name << " gets an upgrade!\n";
+                break;
+            case EV_UPGRADED:
+                out << a->name << " upgraded to " << UPGRADE_NAMES[e.kind] << ".\n";
+                break;
+            case EV_MOVED:
+                if (e.kind == MOVE_TOWARD) out << a->name << " moves toward " << t->name << " to (" << e.x << "," << e.y << ")\n";
+                else out << a->name << " moves to (" << e.x << "," << e.y << ")\n\n";
+                break;
+            case EV_JUMPED:
+                out << a->name << " jumps to (" << e.x << "," << e.y << ") near " << t->name << "\n";
+                break;
+            case EV_RESPAWNED:
+                out << a->name << " respawns at (" << e.x << "," << e.y << ") with " << e.value
+                    << " health and " << a->shells << " shells\n";
+                break;
+            case EV_STALEMATE:
+                if (e.kind == STALE_REPEAT) out << "Stalemate: the game is repeating itself. Ending after turn " << e.turn << ".\n\n";
+                else out << "Stalemate: nothing has happened for " << e.value << " turns. Ending after turn " << e.turn << ".\n\n";
+                break;
+            default:
+                break;
+        }
+    }
+
+private:
+    // Draw battle map
+    void drawMap() {
+        out << string(game.width * 2 + 2, '*') << '\n'; // Top border
+        
+        for (int y = 0; y < game.height; ++y) {
+            out << '*'; // Left border
+            for (int x = 0; x < game.width; ++x) {
+                char cell = '.'; // Empty space
+                // Check for robots at this position
+                for (auto* r : game.robots) {
+                    if (r->isAlive() && !r->hidden && r->getX() == x && r->getY() == y) {
+                        cell = r->symbol; // Robot letter
+                        break;
+                    }
+                }
+                out << cell << " "; // Print cell
+            }
+            out << "*\n"; // Right border
+        }
+        
+        // Bottom border
+        out << string(game.width * 2 + 2, '*') << '\n';
+    }
+};
+
+// Fixed-size binary records: "RWEV", version, then per event
+// int32 turn, u8 type, u8 kind, u8 hit, u8 0, int16 actor, int16 target,
+// int16 x, int16 y, int32 value (native byte order). Robots are by id.
+const int EVENT_RECORD_SIZE = 20;
+
+class BinaryRecorder : public EventSink {
+    ostream& out;
+public:
+    explicit BinaryRecorder(ostream& o) : out(o) {
+        uint32_t version = 1;
+        out.write("RWEV", 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    void onEvent(const Event& e) override {
+        char record[EVENT_RECORD_SIZE] = {};
+        int32_t turn = e.turn, value = e.value;
+        int16_t fields[4] = { (int16_t)(e.actor ? e.actor->id : -1), (int16_t)(e.target ? e.target->id : -1),
+                              (int16_t)e.x, (int16_t)e.y };
+        memcpy(record, &turn, 4);
+        record[4] = (char)e.type;
+        record[5] = (char)e.kind;
+        record[6] = (char)e.hit;
+        memcpy(record + 8, fields, sizeof(fields));
+        memcpy(record + 16, &value, 4);
+        out.write(record, EVENT_RECORD_SIZE);
+        TELEMETRY_ADD(logBytes, EVENT_RECORD_SIZE);
+    }
+};
+
+// Per-robot and per-event-type counts
+class StatsAggregator : public EventSink {
+public:
+    struct RobotStats { int shots = 0, hits = 0, kills = 0, deaths = 0, moves = 0, jumps = 0, upgrades = 0; };
+    vector<RobotStats> robots;
+    long long eventCounts[EV_COUNT] = {};
+
+    void onEvent(const Event& e) override {
+        eventCounts[e.type]++;
+        if (!e.actor) return;
+        RobotStats& s = statsFor(e.actor->id);
+        switch (e.type) {
+            case EV_FIRED:
+                s.shots++;
+                lastShooter = e.actor->id;
+                break;
+            case EV_HIT:
+                if (lastShooter >= 0) statsFor(lastShooter).hits++;
+                break;
+            case EV_DESTROYED:
+                s.deaths++;
+                if (e.kind == DESTROY_KILLED && lastShooter >= 0) statsFor(lastShooter).kills++;
+                break;
+            case EV_MOVED: s.moves++; break;
+            case EV_JUMPED: s.jumps++; break;
+            case EV_UPGRADED: s.upgrades++; break;
+            default: break;
+        }
+    }
+
+    void print(ostream& os, const vector<Robot*>& roster) const {
+        os << left << setw(12) << "Robot" << right << setw(7) << "Shots" << setw(6) << "Hits" << setw(7) << "Kills"
+           << setw(8) << "Deaths" << setw(7) << "Moves" << setw(7) << "Jumps" << setw(10) << "Upgrades" << "\n";
+        for (const Robot* r : roster) {
+            RobotStats s = r->id < (int)robots.size() ? robots[r->id] : RobotStats();
+            os << left << setw(12) << r->name << right << setw(7) << s.shots << setw(6) << s.hits << setw(7) << s.kills
+               << setw(8) << s.deaths << setw(7) << s.moves << setw(7) << s.jumps << setw(10) << s.upgrades << "\n";
+        }
+    }
+
+private:
+    int lastShooter = -1; // hits and kills belong to the last robot that fired
+
+    RobotStats& statsFor(int id) {
+        if (id >= (int)robots.size()) robots.resize(id + 1);
+        return robots[id];
+    }
+};
+
+// Listens and does nothing; same cost as no sink at all
+class NullSink : public EventSink {
+public:
+    void onEvent(const Event&) override {}
+};
+
+
+// BATCHED ENVIRONMENTS
+// Runs many small independent arenas in lockstep. Every robot field lives in
+// its own flat array indexed by env * robotsPerEnv + robot (Structure of
+// Arrays), so a sweep walks contiguous memory with no virtual calls.
+// Only the GenericRobot rules are modelled (look, adjacent fire, chase/wander,
+// respawn queue). Finished games reset in place.
+class BatchedEnvs {
+public:
+    int numEnvs, robotsPerEnv, width, height, maxTurns;
+
+    // Per robot (numEnvs * robotsPerEnv)
+    vector<int> x, y, health, shells, lives, kills, deaths;
+    vector<unsigned char> alive;
+
+    // Per env
+    vector<int> turn;
+    vector<unsigned> rngState;
+    vector<int> queueHead, queueSize; // respawn queue (ring of robotsPerEnv)
+    vector<int> queue;                // numEnvs * robotsPerEnv
+    vector<unsigned char> occupied;   // numEnvs * width * height, alive robots per cell
+    vector<long long> gamesFinished;
+
+    BatchedEnvs(const GameSetup& config, int envs, unsigned seed)
+        : numEnvs(envs), robotsPerEnv((int)config.entries.size()),
+          width(config.width), height(config.height), maxTurns(config.numTurns) {
+        int total = numEnvs * robotsPerEnv;
+        x.assign(total, 0); y.assign(total, 0);
+        health.assign(total, 0); shells.assign(total, 0); lives.assign(total, 0);
+        kills.assign(total, 0); deaths.assign(total, 0);
+        alive.assign(total, 0);
+        turn.assign(numEnvs, 1);
+        rngState.resize(numEnvs);
+        queueHead.assign(numEnvs, 0); queueSize.assign(numEnvs, 0);
+        queue.assign(total, 0);
+        occupied.assign((size_t)numEnvs * width * height, 0);
+        gamesFinished.assign(numEnvs, 0);
+
+        // Fixed spawn points from setup (-1 means random). A point that isn't
+        // on the map is rolled at random instead, it would index past occupied.
+        for (const RobotEntry& entry : config.entries) {
+            bool fixedX = entry.xs != "random" && validCoordinate(entry.xs, width);
+            bool fixedY = entry.ys != "random" && validCoordinate(entry.ys, height);
+            spawnX.push_back(fixedX ? atoi(entry.xs.c_str()) : -1);
+            spawnY.push_back(fixedY ? atoi(entry.ys.c_str()) : -1);
+        }
+        for (int e = 0; e < numEnvs; ++e) {
+            rngState[e] = mixSeed(((unsigned long long)seed << 32) | (unsigned)e);
+            reset(e);
+        }
+    }
+
+    // Put env e back to its starting state
+    void reset(int e) {
+        int base = e * robotsPerEnv;
+        unsigned char* occ = &occupied[(size_t)e * width * height];
+        fill(occ, occ + width * height, 0);
+        for (int i = 0; i < robotsPerEnv; ++i) {
+            int r = base + i;
+            x[r] = spawnX[i] >= 0 ? spawnX[i] : (int)(nextRand(rngState[e]) % width);
+            y[r] = spawnY[i] >= 0 ? spawnY[i] : (int)(nextRand(rngState[e]) % height);
+            health[r] = 1; shells[r] = 10; lives[r] = 2;
+            kills[r] = 0; deaths[r] = 0;
+            alive[r] = 1;
+            occ[y[r] * width + x[r]]++;
+        }
+        queueHead[e] = 0; queueSize[e] = 0;
+        turn[e] = 1;
+    }
+
+    // Advance env e by one turn, resetting it if the game is over
+    void step(int e) {
+        int base = e * robotsPerEnv;
+        unsigned& rng = rngState[e];
+        unsigned char* occ = &occupied[(size_t)e * width * height];
+
+        int aliveCount = 0;
+        for (int i = 0; i < robotsPerEnv; ++i) aliveCount += alive[base + i];
+        if (turn[e] > maxTurns || (aliveCount <= 1 && queueSize[e] == 0)) {
+            gamesFinished[e]++;
+            reset(e);
+            return;
+        }
+
+        // Respawn front of queue
+        if (queueSize[e] > 0) {
+            int r = queue[base + queueHead[e]];
+            queueHead[e] = (queueHead[e] + 1) % robotsPerEnv;
+            queueSize[e]--;
+            int nx, ny;
+            do {
+                nx = nextRand(rng) % width;
+                ny = nextRand(rng) % height;
+            } while (occ[ny * width + nx]);
+            x[r] = nx; y[r] = ny;
+            health[r] = 1;
+            alive[r] = 1;
+            occ[ny * width + nx]++;
+        }
+
+        // Each robot thinks in order
+        int seen[8];
+        for (int i = 0; i < robotsPerEnv; ++i) {
+            int self = base + i;
+            if (!alive[self]) continue;
+
+            // Look at the 8 neighbours, same scan order as performSeeing
+            int numSeen = 0;
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    if (dx == 0 && dy == 0) continue;
+                    int nx = x[self] + dx, ny = y[self] + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height || !occ[ny * width + nx]) continue;
+                    for (int j = 0; j < robotsPerEnv && numSeen < 8; ++j) {
+                        int o = base + j;
+                        if (o != self && alive[o] && x[o] == nx && y[o] == ny) {
+                            seen[numSeen++] = o;
+                        }
+                    }
+                }
+            }
+
+            // Fire at a random adjacent target
+            if (numSeen > 0 && shells[self] > 0) {
+                int target = seen[nextRand(rng) % numSeen];
+                shells[self]--;
+                if (nextRand(rng) % 100 < 70) {
+                    if (--health[target] <= 0) {
+                        alive[target] = 0;
+                        deaths[target]++;
+                        occ[y[target] * width + x[target]]--;
+                        kills[self]++;
+                    }
+                }
+                if (shells[self] <= 0) { // Self destruct
+                    alive[self] = 0;
+                    deaths[self]++;
+                    occ[y[self] * width + x[self]]--;
+                    continue;
+                }
+            }
+
+            // Move toward closest seen target, otherwise wander
+            int cx = x[self], cy = y[self];
+            bool moved = false;
+            int closest = -1, minDist = INT_MAX;
+            for (int k = 0; k < numSeen; ++k) {
+                int t = seen[k];
+                if (!alive[t]) continue;
+                int dist = abs(x[t] - cx) + abs(y[t] - cy);
+                if (dist < minDist) { minDist = dist; closest = t; }
+            }
+            if (closest >= 0) {
+                int nx = cx + ((x[closest] > cx) - (x[closest] < cx));
+                int ny = cy + ((y[closest] > cy) - (y[closest] < cy));
+                if (nx >= 0 && nx < width && ny >= 0 && ny < height && !occ[ny * width + nx]) {
+                    moveRobot(occ, self, nx, ny);
+                    moved = true;
+                }
+            }
+            if (!moved) {
+                int options[8], numOptions = 0;
+                for (int dx = -1; dx <= 1; dx++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        if (dx == 0 && dy == 0) continue;
+                        int nx = cx + dx, ny = cy + dy;
+                        if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                        if (!occ[ny * width + nx]) options[numOptions++] = ny * width + nx;
+                    }
+                }
+                if (numOptions > 0) {
+                    int cell = options[nextRand(rng) % numOptions];
+                    moveRobot(occ, self, cell % width, cell / width);
+                }
+            }
+        }
+
+        // Queue dead robots for respawn
+        for (int i = 0; i < robotsPerEnv; ++i) {
+            int r = base + i;
+            if (alive[r] || lives[r] <= 0 || isQueued(e, r)) continue;
+            lives[r]--;
+            queue[base + (queueHead[e] + queueSize[e]) % robotsPerEnv] = r;
+            queueSize[e]++;
+        }
+        turn[e]++;
+    }
+
+    // Advance envs [first, last) together for the given number of turns
+    void stepRange(int first, int last, int turns) {
+        for (int t = 0; t < turns; ++t) {
+            for (int e = first; e < last; ++e) step(e);
+        }
+    }
+
+    // Advance every env, splitting the batch across worker threads
+    void stepAll(int turns, int numThreads) {
+        numThreads = max(1, min(numThreads, numEnvs));
+        vector<thread> workers;
+        int chunk = (numEnvs + numThreads - 1) / numThreads;
+        for (int t = 0; t < numThreads; ++t) {
+            int first = t * chunk, last = min(numEnvs, first + chunk);
+            if (first >= last) break;
+            workers.emplace_back(&BatchedEnvs::stepRange, this, first, last, turns);
+        }
+        for (thread& w : workers) w.join();
+    }
+
+    long long totalGamesFinished() const {
+        long long total = 0;
+        for (long long g : gamesFinished) total += g;
+        return total;
+    }
+
+private:
+    vector<int> spawnX, spawnY;
+
+    void moveRobot(unsigned char* occ, int r, int nx, int ny) {
+        occ[y[r] * width + x[r]]--;
+        x[r] = nx; y[r] = ny;
+        occ[ny * width + nx]++;
+    }
+
+    bool isQueued(int e, int r) const {
+        int base = e * robotsPerEnv;
+        for (int k = 0; k < queueSize[e]; ++k) {
+            if (queue[base + (queueHead[e] + k) % robotsPerEnv] == r) return true;
+        }
+        return false;
+    }
+};
+
+// --batch [setup] [envs] [turns] [threads] [seed]
+// Benchmarks batched environments and reports env-steps/sec
+int runBatchMode(int argc, char* argv[]) {
+    string setupPath = argc > 2 ? argv[2] : "setup.txt";
+    int envs = argc > 3 ? atoi(argv[3]) : 4096;
+    int turns = argc > 4 ? atoi(argv[4]) : 1000;
+    int threads = argc > 5 ? atoi(argv[5]) : (int)thread::hardware_concurrency();
+    unsigned seed = argc > 6 ? (unsigned)strtoul(argv[6], nullptr, 10) : (unsigned)time(0);
+
+    ifstream setup(setupPath);
+    if (!setup) {
+        cerr << "Failed to open " << setupPath << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    for (const RobotEntry& entry : config.entries) {
+        if (entry.type != "GenericRobot") {
+            cerr << "Batch mode only models GenericRobot, treating " << entry.name << " (" << entry.type << ") as one" << endl;
+        }
+        if (!validCoordinate(entry.xs, max(config.width, 0)) || !validCoordinate(entry.ys, max(config.height, 0))) {
+            cerr << entry.name << " has no start position on the map, placing it at random" << endl;
+        }
+    }
+    cerr << "Note: batch robots don't take the upgrade the engine rolls on each kill,"
+         << " so batch games play out differently from a real game" << endl;
+    if (config.entries.empty() || config.width <= 0 || config.height <= 0 || envs <= 0 || turns <= 0) {
+        cerr << "Nothing to run" << endl;
+        return 1;
+    }
+
+    BatchedEnvs batch(config, envs, seed);
+    auto start = chrono::steady_clock::now();
+    batch.stepAll(turns, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long long envSteps = (long long)envs * turns;
+    cout << "Envs: " << envs << " (" << config.width << "x" << config.height << ", "
+         << batch.robotsPerEnv << " robots) Threads: " << max(1, threads) << endl;
+    cout << "Env-steps: " << envSteps << " in " << fixed << setprecision(3) << seconds << "s" << endl;
+    cout << "Env-steps/sec: " << fixed << setprecision(0) << (seconds > 0 ? envSteps / seconds : 0) << endl;
+    cout << "Games finished: " << batch.totalGamesFinished() << endl;
+    return 0;
+}
+
+// Reusable thread barrier; the last thread to arrive runs onComplete
+// before anyone is released
+class TurnBarrier {
+    mutex m;
+    condition_variable cv;
+    int count, waiting = 0, generation = 0;
+public:
+    explicit TurnBarrier(int n) : count(n) {}
+    void arriveAndWait(const function<void()>& onComplete = nullptr) {
+        unique_lock<mutex> lock(m);
+        int gen = generation;
+        if (++waiting == count) {
+            if (onComplete) onComplete();
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&] { return gen != generation; });
         }
-        cout << endl;
-        turn++;
     }
+};
+
+// SHARDED ARENA
+// Large maps split into horizontal bands of rows, one worker thread per band.
+// Turns are simultaneous: every robot plans from the same turn-start snapshot,
+// then hits and moves land together. A band only reads its neighbours through
+// a halo of border rows, and robots migrate when they cross a band edge.
+// Every dice roll is keyed on (seed, turn, robot, draw), so the outcome does
+// not depend on how many bands the map is cut into.
+// GenericRobot, LongShotBot and JumpBot rules are modelled.
+const int SHARD_HALO = 3; // 1-cell vision, 3-cell LongShot, JumpBot lands within 2
+const int SHARD_PLACE_DRAWS = 1000; // random tries before placing on the first free cell
+
+inline unsigned shardRand(unsigned seed, int turn, int id, int draw) {
+    unsigned h = mixSeed(((unsigned long long)seed << 32) | (unsigned)turn);
+    h = mixSeed(((unsigned long long)h << 32) | (unsigned)id);
+    return mixSeed(((unsigned long long)h << 32) | (unsigned)draw);
+}
+
+struct ShardRobot {
+    string name;
+    int x = 0, y = 0, health = 1, shells = 10, lives = 2;
+    int kills = 0, deaths = 0, jumpsLeft = 0;
+    bool alive = true, longShot = false;
+};
+
+// What a robot decided this turn
+struct ShardPlan {
+    int target = -1;        // robot fired at
+    bool hit = false;
+    bool selfDestruct = false;
+    int dest = -1;          // cell index it wants to move to
+    bool jump = false;
+};
+
+// Message between bands: a = robot it is about, b = other robot / cell, c = sender band
+struct ShardMsg { int a, b, c; };
+
+class ShardedArena {
+public:
+    int width, height, maxTurns, numRegions;
+    unsigned seed;
+    int turn = 1;
+    bool finished = false;
+    vector<ShardRobot> robots;
+
+    ShardedArena(const GameSetup& config, int regionsWanted, unsigned s)
+        : width(config.width), height(config.height), maxTurns(config.numTurns), seed(s) {
+        // Bands must be at least a halo tall so a halo never spans two bands
+        numRegions = max(1, min(regionsWanted, height / SHARD_HALO));
+        regions.resize(numRegions);
+        rowOwner.resize(height);
+        for (int w = 0; w < numRegions; ++w) {
+            Region& reg = regions[w];
+            reg.y0 = height * w / numRegions;
+            reg.y1 = height * (w + 1) / numRegions;
+            reg.gy0 = max(0, reg.y0 - SHARD_HALO);
+            reg.gy1 = min(height, reg.y1 + SHARD_HALO);
+            reg.grid.assign((reg.gy1 - reg.gy0) * width, -1);
+            for (int y = reg.y0; y < reg.y1; ++y) rowOwner[y] = w;
+            for (auto* box : { &reg.hitsOut, &reg.movesOut, &reg.creditsOut, &reg.acceptOut, &reg.migrantsOut }) {
+                box->resize(numRegions);
+            }
+        }
+
+        // Place robots; later arrivals on a taken cell get re-rolled
+        for (int id = 0; id < (int)config.entries.size(); ++id) {
+            const RobotEntry& entry = config.entries[id];
+            ShardRobot r;
+            r.name = entry.name;
+            r.longShot = entry.type == "LongShotBot";
+            if (entry.type == "JumpBot") r.jumpsLeft = 3;
+            int x = validCoordinate(entry.xs, width) && entry.xs != "random" ? atoi(entry.xs.c_str()) : -1;
+            int y = validCoordinate(entry.ys, height) && entry.ys != "random" ? atoi(entry.ys.c_str()) : -1;
+            for (int draw = 0; x < 0 || y < 0 || cellAt(x, y) >= 0; ++draw) {
+                if (draw == SHARD_PLACE_DRAWS) { // Crowded map: take the first free cell
+                    for (int cell = 0; cell < width * height; ++cell) {
+                        if (cellAt(cell % width, cell / width) < 0) {
+                            x = cell % width;
+                            y = cell / width;
+                            break;
+                        }
+                    }
+                    break;
+                }
+                x = shardRand(seed, 0, id, 2 * draw) % width;
+                y = shardRand(seed, 0, id, 2 * draw + 1) % height;
+            }
+            r.x = x; r.y = y;
+            robots.push_back(r);
+            Region& reg = regions[rowOwner[y]];
+            reg.residents.push_back(id);
+            reg.cell(x, y, width) = id;
+        }
+        plans.resize(robots.size());
+        diedThisTurn.assign(robots.size(), 0);
+        finished = turn > maxTurns || robots.size() <= 1;
+        for (int w = 0; w < numRegions; ++w) publish(w);
+    }
+
+    // Play until the game ends, one thread per band
+    void run() {
+        TurnBarrier b(numRegions);
+        activeBarrier = &b;
+        vector<thread> workers;
+        for (int w = 0; w < numRegions; ++w) workers.emplace_back(&ShardedArena::worker, this, w);
+        for (thread& t : workers) t.join();
+        activeBarrier = nullptr;
+    }
+
+    // Order-independent fingerprint of every robot's state
+    unsigned long long checksum() const {
+        unsigned long long h = 1469598103934665603ULL;
+        for (const ShardRobot& r : robots) {
+            for (int v : { r.x, r.y, r.health, r.shells, r.lives, r.kills, r.deaths, r.jumpsLeft, (int)r.alive }) {
+                h = (h ^ (unsigned)v) * 1099511628211ULL;
+            }
+        }
+        return h;
+    }
+
+private:
+    struct Region {
+        int y0, y1;   // owned rows [y0, y1)
+        int gy0, gy1; // rows held locally, including halo
+        vector<int> grid; // robot id per cell or -1
+        vector<int> residents;
+        vector<int> topRows, bottomRows; // published border rows
+        vector<vector<ShardMsg>> hitsOut, movesOut, creditsOut, acceptOut, migrantsOut; // per destination band
+
+        int& cell(int x, int y, int width) { return grid[(y - gy0) * width + x]; }
+    };
+
+    vector<Region> regions;
+    vector<int> rowOwner;
+    vector<ShardPlan> plans;
+    vector<unsigned char> diedThisTurn;
+    vector<int> respawnQueue;
+    TurnBarrier* activeBarrier = nullptr;
+
+    int cellAt(int x, int y) { return regions[rowOwner[y]].cell(x, y, width); }
+
+    void worker(int w) {
+        TurnBarrier& b = *activeBarrier;
+        while (true) {
+            copyHalo(w);
+            if (finished) break;
+            plan(w);     b.arriveAndWait();
+            applyHits(w); b.arriveAndWait();
+            resolveMoves(w); b.arriveAndWait();
+            applyMoves(w); b.arriveAndWait();
+            rebuild(w);  b.arriveAndWait([this] { endTurn(); });
+            publish(w);  b.arriveAndWait();
+        }
+    }
+
+    // Pull neighbours' border rows into our halo
+    void copyHalo(int w) {
+        Region& reg = regions[w];
+        if (w > 0) {
+            const Region& up = regions[w - 1];
+            int rows = reg.y0 - reg.gy0; // halo rows above us are up's last rows
+            copy(up.bottomRows.end() - rows * width, up.bottomRows.end(), reg.grid.begin());
+        }
+        if (w + 1 < numRegions) {
+            const Region& down = regions[w + 1];
+            int rows = reg.gy1 - reg.y1;
+            copy(down.topRows.begin(), down.topRows.begin() + rows * width,
+                 reg.grid.begin() + (reg.y1 - reg.gy0) * width);
+        }
+    }
+
+    // Decide shots and moves from the snapshot (own rows + halo)
+    void plan(int w) {
+        Region& reg = regions[w];
+        for (auto* box : { &reg.hitsOut, &reg.movesOut }) for (auto& v : *box) v.clear();
+        vector<int> seen;
+        vector<int> options;
+        for (int id : reg.residents) {
+            ShardRobot& r = robots[id];
+            ShardPlan& p = plans[id];
+            p = ShardPlan();
+            int draw = 0;
+            auto roll = [&](unsigned n) { return shardRand(seed, turn, id, draw++) % n; };
+
+            // Look around: 8 neighbours, or Manhattan 3 for LongShot
+            seen.clear();
+            int range = r.longShot ? 3 : 1;
+            for (int dx = -range; dx <= range; dx++) {
+                for (int dy = -range; dy <= range; dy++) {
+                    if (dx == 0 && dy == 0) continue;
+                    if (r.longShot && abs(dx) + abs(dy) > 3) continue;
+                    int nx = r.x + dx, ny = r.y + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                    if (reg.cell(nx, ny, width) >= 0) seen.push_back(ny * width + nx);
+                }
+            }
+
+            // Fire at a random visible target
+            if (!seen.empty() && r.shells > 0) {
+                int at = seen[roll(seen.size())];
+                p.target = reg.cell(at % width, at / width, width);
+                p.hit = roll(100) < 70;
+                r.shells--;
+                if (r.shells <= 0) p.selfDestruct = true;
+                if (p.hit) reg.hitsOut[rowOwner[at / width]].push_back({ p.target, id, w });
+            }
+            if (p.selfDestruct) continue;
+
+            // Closest visible robot
+            int closest = -1, minDist = INT_MAX;
+            for (int at : seen) {
+                int dist = abs(at % width - r.x) + abs(at / width - r.y);
+                if (dist < minDist) { minDist = dist; closest = at; }
+            }
+
+            auto isFree = [&](int nx, int ny) {
+                return nx >= 0 && ny >= 0 && nx < width && ny < height && reg.cell(nx, ny, width) < 0;
+            };
+
+            // JumpBot lands next to the closest target
+            if (r.jumpsLeft > 0 && closest >= 0) {
+                options.clear();
+                for (int dx = -1; dx <= 1; dx++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        int nx = closest % width + dx, ny = closest / width + dy;
+                        if ((dx || dy) && isFree(nx, ny)) options.push_back(ny * width + nx);
+                    }
+                }
+                if (!options.empty()) {
+                    p.dest = options[roll(options.size())];
+                    p.jump = true;
+                }
+            }
+
+            // Step toward the target, otherwise wander
+            if (p.dest < 0 && closest >= 0) {
+                int tx = closest % width, ty = closest / width;
+                int nx = r.x + ((tx > r.x) - (tx < r.x));
+                int ny = r.y + ((ty > r.y) - (ty < r.y));
+                if (isFree(nx, ny)) p.dest = ny * width + nx;
+            }
+            if (p.dest < 0) {
+                options.clear();
+                for (int dx = -1; dx <= 1; dx++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        int nx = r.x + dx, ny = r.y + dy;
+                        if ((dx || dy) && isFree(nx, ny)) options.push_back(ny * width + nx);
+                    }
+                }
+                if (!options.empty()) p.dest = options[roll(options.size())];
+            }
+            if (p.dest >= 0) reg.movesOut[rowOwner[p.dest / width]].push_back({ id, p.dest, w });
+        }
+    }
+
+    // Land incoming hits on our residents, lowest shooter first
+    void applyHits(int w) {
+        Region& reg = regions[w];
+        for (auto& v : reg.creditsOut) v.clear();
+        vector<ShardMsg> hits;
+        for (Region& from : regions) hits.insert(hits.end(), from.hitsOut[w].begin(), from.hitsOut[w].end());
+        sort(hits.begin(), hits.end(), [](const ShardMsg& a, const ShardMsg& b) {
+            return a.a != b.a ? a.a < b.a : a.b < b.b;
+        });
+        for (const ShardMsg& hit : hits) {
+            ShardRobot& t = robots[hit.a];
+            if (t.health <= 0) continue;
+            if (--t.health <= 0) reg.creditsOut[hit.c].push_back({ hit.b, hit.a, w });
+        }
+        for (int id : reg.residents) {
+            ShardRobot& r = robots[id];
+            if (r.health <= 0 || plans[id].selfDestruct) {
+                r.alive = false;
+                r.deaths++;
+                diedThisTurn[id] = 1;
+            }
+        }
+    }
+
+    // Hand out kill credits and settle who gets each contested cell
+    void resolveMoves(int w) {
+        Region& reg = regions[w];
+        for (auto& v : reg.acceptOut) v.clear();
+        for (Region& from : regions) {
+            for (const ShardMsg& credit : from.creditsOut[w]) robots[credit.a].kills++;
+        }
+        vector<ShardMsg> moves;
+        for (Region& from : regions) moves.insert(moves.end(), from.movesOut[w].begin(), from.movesOut[w].end());
+        sort(moves.begin(), moves.end(), [](const ShardMsg& a, const ShardMsg& b) {
+            return a.b != b.b ? a.b < b.b : a.a < b.a;
+        });
+        int lastTaken = -1;
+        for (const ShardMsg& move : moves) {
+            if (move.b == lastTaken || diedThisTurn[move.a]) continue;
+            lastTaken = move.b;
+            reg.acceptOut[move.c].push_back(move);
+        }
+    }
+
+    // Move residents, drop the dead and send leavers to their new band
+    void applyMoves(int w) {
+        Region& reg = regions[w];
+        for (auto& v : reg.migrantsOut) v.clear();
+        for (Region& from : regions) {
+            for (const ShardMsg& move : from.acceptOut[w]) {
+                ShardRobot& r = robots[move.a];
+                r.x = move.b % width;
+                r.y = move.b / width;
+                if (plans[move.a].jump) r.jumpsLeft--;
+            }
+        }
+        vector<int> staying;
+        for (int id : reg.residents) {
+            const ShardRobot& r = robots[id];
+            if (!r.alive) continue;
+            if (rowOwner[r.y] != w) reg.migrantsOut[rowOwner[r.y]].push_back({ id, 0, w });
+            else staying.push_back(id);
+        }
+        reg.residents.swap(staying);
+    }
+
+    // Take in arrivals and redraw our own rows
+    void rebuild(int w) {
+        Region& reg = regions[w];
+        for (Region& from : regions) {
+            for (const ShardMsg& m : from.migrantsOut[w]) reg.residents.push_back(m.a);
+        }
+        sort(reg.residents.begin(), reg.residents.end());
+        fill(reg.grid.begin(), reg.grid.end(), -1);
+        for (int id : reg.residents) reg.cell(robots[id].x, robots[id].y, width) = id;
+    }
+
+    // Runs on one thread between turns: respawn queue and end of game
+    void endTurn() {
+        for (int id = 0; id < (int)robots.size(); ++id) {
+            if (diedThisTurn[id] && robots[id].lives > 0) {
+                robots[id].lives--;
+                respawnQueue.push_back(id);
+            }
+            diedThisTurn[id] = 0;
+        }
+        turn++;
+
+        int aliveCount = 0;
+        for (Region& reg : regions) aliveCount += reg.residents.size();
+        if (turn > maxTurns || (aliveCount <= 1 && respawnQueue.empty())) {
+            finished = true;
+            return;
+        }
+
+        // Respawn front of queue on a free cell
+        if (!respawnQueue.empty()) {
+            int id = respawnQueue.front();
+            for (int draw = 0; draw < width * height * 4; draw += 2) {
+                int x = shardRand(seed, turn, id, 1000 + draw) % width;
+                int y = shardRand(seed, turn, id, 1001 + draw) % height;
+                Region& reg = regions[rowOwner[y]];
+                if (reg.cell(x, y, width) >= 0) continue;
+                ShardRobot& r = robots[id];
+                r.x = x; r.y = y;
+                r.health = 1;
+                r.alive = true;
+                reg.residents.push_back(id);
+                reg.cell(x, y, width) = id;
+                respawnQueue.erase(respawnQueue.begin());
+                break;
+            }
+        }
+    }
+
+    // Share our border rows with the bands above and below
+    void publish(int w) {
+        Region& reg = regions[w];
+        int rows = min(SHARD_HALO, reg.y1 - reg.y0);
+        auto ownStart = reg.grid.begin() + (reg.y0 - reg.gy0) * width;
+        auto ownEnd = reg.grid.begin() + (reg.y1 - reg.gy0) * width;
+        reg.topRows.assign(ownStart, ownStart + rows * width);
+        reg.bottomRows.assign(ownEnd - rows * width, ownEnd);
+    }
+};
+
+// --shard [setup] [regions] [seed] [verify]
+// Plays one game on the sharded arena; "verify" replays it on a single band
+// and checks both runs end in the same state
+int runShardMode(int argc, char* argv[]) {
+    string setupPath = argc > 2 ? argv[2] : "setup.txt";
+    int regionCount = argc > 3 ? atoi(argv[3]) : (int)thread::hardware_concurrency();
+    unsigned seed = argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 10) : (unsigned)time(0);
+    bool verify = argc > 5 && string(argv[5]) == "verify";
+
+    ifstream setup(setupPath);
+    if (!setup) {
+        cerr << "Failed to open " << setupPath << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    if (!validSetup(config) || config.entries.size() > (size_t)config.width * config.height) {
+        cerr << "Bad setup: check the map size, robot count and start positions" << endl;
+        return 1;
+    }
+    for (const RobotEntry& entry : config.entries) {
+        if (entry.type != "GenericRobot" && entry.type != "LongShotBot" && entry.type != "JumpBot") {
+            cerr << "Shard mode only models GenericRobot, LongShotBot and JumpBot, treating " << entry.name << " ("
+                 << entry.type << ") as a GenericRobot" << endl;
+        }
+    }
+
+    ShardedArena arena(config, regionCount, seed);
+    auto start = chrono::steady_clock::now();
+    arena.run();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int aliveCount = 0;
+    for (const ShardRobot& r : arena.robots) aliveCount += r.alive;
+    cout << "Map: " << arena.width << "x" << arena.height << " Robots: " << arena.robots.size()
+         << " Bands: " << arena.numRegions << " Seed: " << seed << endl;
+    cout << "Turns: " << arena.turn - 1 << " in " << fixed << setprecision(3) << seconds << "s" << endl;
+    cout << "Alive at end: " << aliveCount << endl;
+    cout << "Checksum: " << hex << arena.checksum() << dec << endl;
+
+    if (verify) {
+        ShardedArena reference(config, 1, seed);
+        reference.run();
+        bool match = reference.checksum() == arena.checksum() && reference.turn == arena.turn;
+        cout << "Single band checksum: " << hex << reference.checksum() << dec
+             << (match ? " (match)" : " (MISMATCH)") << endl;
+        return match ? 0 : 2;
+    }
+    return 0;
+}
+
+// SIMULATION DAEMON
+// Long running server on a Unix domain socket. A client sends
+//   RUN summary|events [seed]
+//   <setup.txt contents>
+//   END
+// and gets back "OK" plus the final status, or "OK" plus the game's binary
+// event records (see BinaryRecorder), sent turn by turn.
+// "SHUTDOWN" stops the server once queued games are done. Games run on a
+// fixed pool of worker threads, each owning one Game arena reused between
+// requests. Connections beyond the queue depth are turned away with "ERROR busy".
+
+bool sendAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool sendText(int fd, const string& text) { return sendAll(fd, text.data(), text.size()); }
+
+const int REQUEST_TIMEOUT_SEC = 10; // Seconds a client gets to send its whole request
+const int REPLY_STALL_SEC = 10;     // Seconds a reply may wait on a client that isn't reading
+
+// Read header line and setup text up to the END line (or EOF). The whole
+// request has to arrive within REQUEST_TIMEOUT_SEC, however it is trickled in.
+bool readRequest(int fd, string& header, string& body) {
+    string data;
+    char buf[4096];
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(REQUEST_TIMEOUT_SEC);
+    while (data.find("\nEND\n") == string::npos) {
+        long long left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        pollfd p = { fd, POLLIN, 0 };
+        if (left <= 0 || poll(&p, 1, (int)left) <= 0) return false; // Out of time
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0) return false;
+        if (n == 0) break;
+        data.append(buf, n);
+        if (data.size() > (1 << 20)) return false; // Too big
+    }
+    size_t eol = data.find('\n');
+    header = data.substr(0, eol);
+    if (eol == string::npos) return !header.empty();
+    body = data.substr(eol + 1);
+    size_t end = body.find("\nEND\n");
+    if (end != string::npos) body.resize(end + 1);
+    else if (body.compare(0, 4, "END\n") == 0) body.clear();
+    return true;
+}
+
+class SimServer {
+public:
+    SimServer(const string& p, int workers, int depth)
+        : path(p), numWorkers(max(1, workers)), queueDepth(max(1, depth)), arenas(numWorkers) {}
+
+    // Serve until a SHUTDOWN request arrives
+    int run() {
+        signal(SIGPIPE, SIG_IGN); // Clients may hang up early
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (listenFd < 0 || path.size() >= sizeof(addr.sun_path)) {
+            cerr << "Cannot create socket " << path << endl;
+            return 1;
+        }
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str()); // Remove stale socket file
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, queueDepth) < 0) {
+            cerr << "Cannot listen on " << path << endl;
+            close(listenFd);
+            return 1;
+        }
+        cerr << "Listening on " << path << " (" << numWorkers << " workers, queue " << queueDepth << ")" << endl;
+
+        vector<thread> workers;
+        for (int w = 0; w < numWorkers; ++w) workers.emplace_back(&SimServer::worker, this, w);
+
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                break; // Listening socket shut down
+            }
+            unique_lock<mutex> lock(m);
+            if (stopping || (int)pending.size() >= queueDepth) {
+                lock.unlock();
+                sendText(fd, "ERROR busy\n");
+                close(fd);
+                continue;
+            }
+            pending.push_back(fd);
+            cv.notify_one();
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (thread& t : workers) t.join();
+        close(listenFd);
+        unlink(path.c_str());
+        return 0;
+    }
+
+private:
+    string path;
+    int numWorkers, queueDepth;
+    vector<Game> arenas; // Pre-allocated, one per worker
+    int listenFd = -1;
+    mutex m;
+    condition_variable cv;
+    deque<int> pending; // Accepted connections waiting for a worker
+    bool stopping = false;
+
+    void worker(int w) {
+        while (true) {
+            int fd;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&] { return stopping || !pending.empty(); });
+                if (pending.empty()) return;
+                fd = pending.front();
+                pending.pop_front();
+            }
+            handle(fd, arenas[w]);
+            close(fd);
+        }
+    }
+
+    void handle(int fd, Game& game) {
+        // A client that stops reading its reply must not hold the worker forever
+        timeval timeout{};
+        timeout.tv_sec = REPLY_STALL_SEC;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        string header, body;
+        if (!readRequest(fd, header, body)) {
+            sendText(fd, "ERROR bad request\n");
+            return;
+        }
+        istringstream words(header);
+        string command, mode;
+        words >> command >> mode;
+
+        if (command == "SHUTDOWN") {
+            {
+                lock_guard<mutex> lock(m);
+                stopping = true;
+            }
+            shutdown(listenFd, SHUT_RDWR); // Wakes up accept()
+            sendText(fd, "OK\n");
+            return;
+        }
+        if (command != "RUN" || (mode != "summary" && mode != "events")) {
+            sendText(fd, "ERROR expected RUN summary|events [seed]\n");
+            return;
+        }
+
+        GameSetup config;
+        istringstream setupText(body);
+        readSetup(setupText, config);
+        if (!validSetup(config)) { // Bad input must not take the server down
+            sendText(fd, "ERROR bad setup\n");
+            return;
+        }
+        for (const RobotEntry& entry : config.entries) {
+            // Clients don't get to load files from the server's disk
+            if (isScriptType(entry.type)) {
+                sendText(fd, "ERROR script robots are not allowed over the socket\n");
+                return;
+            }
+        }
+        unsigned seed;
+        if (!(words >> seed)) seed = config.hasSeed ? config.seed : (unsigned)time(0);
+
+        game.setup(config, seed); // No sinks: nothing narrated in summary mode
+
+        if (mode == "summary") {
+            game.play();
+            ostringstream reply;
+            Robot* winner = game.survivor();
+            reply << "OK\n" << "seed: " << seed << "\nturns: " << game.turn - 1
+                  << "\nwinner: " << (winner ? winner->name : "none") << "\n";
+            for (Robot* r : game.robots) reply << *r << "\n";
+            reply << "END\n";
+            sendText(fd, reply.str());
+        } else {
+            ostringstream buffer;
+            BinaryRecorder recorder(buffer);
+            game.bus.attach(&recorder);
+            bool connected = sendText(fd, "OK\n");
+            while (connected && game.playTurn()) {
+                string bytes = buffer.str();
+                connected = sendAll(fd, bytes.data(), bytes.size());
+                buffer.str("");
+            }
+            game.bus.detach(&recorder);
+        }
+        game.clear();
+    }
+};
+
+// Writes the telemetry counters in Prometheus text format every interval,
+// either to a file (replaced atomically) or to anyone who connects to a
+// Unix socket ("unix:/path"). A thread whose seconds_since_turn keeps
+// growing while in_respawn_search is 1 is stuck placing a respawn.
+class TelemetrySampler {
+public:
+    ~TelemetrySampler() { stop(); }
+
+    bool start(const string& target, int intervalMs) {
+        interval = chrono::milliseconds(intervalMs);
+        if (target.compare(0, 5, "unix:") == 0) {
+            socketPath = target.substr(5);
+            listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+            unlink(socketPath.c_str());
+            if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0) {
+                cerr << "Metrics socket " << socketPath << ": " << strerror(errno) << endl;
+                return false;
+            }
+        } else {
+            filePath = target;
+        }
+        telemetryEnabled = true;
+        started = chrono::steady_clock::now();
+        worker = thread([this]() { loop(); });
+        return true;
+    }
+
+    void stop() {
+        if (!worker.joinable()) return;
+        stopping = true;
+        worker.join();
+        if (!filePath.empty()) writeFile(); // Final numbers
+        if (listenFd >= 0) {
+            close(listenFd);
+            unlink(socketPath.c_str());
+        }
+    }
+
+private:
+    chrono::milliseconds interval{1000};
+    string filePath, socketPath;
+    int listenFd = -1;
+    atomic<bool> stopping{false};
+    thread worker;
+    chrono::steady_clock::time_point started, lastSample;
+    long long lastTurns = 0;
+    double turnsPerSec = 0;
+
+    void loop() {
+        lastSample = chrono::steady_clock::now();
+        auto nextWrite = lastSample + interval;
+        while (!stopping) {
+            if (listenFd >= 0) {
+                pollfd p = { listenFd, POLLIN, 0 };
+                if (poll(&p, 1, 50) > 0) {
+                    int fd = accept(listenFd, nullptr, nullptr);
+                    if (fd >= 0) {
+                        sendText(fd, render());
+                        close(fd);
+                    }
+                }
+            } else {
+                this_thread::sleep_for(chrono::milliseconds(50));
+                if (chrono::steady_clock::now() >= nextWrite) {
+                    writeFile();
+                    nextWrite += interval;
+                }
+            }
+        }
+    }
+
+    void writeFile() {
+        string tmp = filePath + ".tmp";
+        {
+            ofstream out(tmp);
+            out << render();
+        }
+        rename(tmp.c_str(), filePath.c_str());
+    }
+
+    // One running thread's per-thread series
+    struct ThreadRow {
+        int id;
+        long long turns, lastTurnNs;
+        int inRespawnSearch;
+    };
+
+    string render() {
+        TelemetryTotals total;
+        long long alive = 0, queue = 0;
+        vector<ThreadRow> threads;
+        {
+            // Blocks are freed when their thread exits, so read them under the lock
+            lock_guard<mutex> lock(telemetryLock);
+            total = telemetryRetired;
+            for (TelemetryCounters* c : telemetryThreads) {
+                total.turns += c->turns.load(memory_order_relaxed);
+                total.shots += c->shots.load(memory_order_relaxed);
+                total.hits += c->hits.load(memory_order_relaxed);
+                total.logBytes += c->logBytes.load(memory_order_relaxed);
+                total.allocations += c->allocations.load(memory_order_relaxed);
+                total.respawnTries += c->respawnTries.load(memory_order_relaxed);
+                alive += c->alive.load(memory_order_relaxed);
+                queue += c->respawnQueue.load(memory_order_relaxed);
+                threads.push_back({ c->id, c->turns.load(memory_order_relaxed), c->lastTurnNs.load(memory_order_relaxed),
+                                    c->inRespawnSearch.load(memory_order_relaxed) });
+            }
+        }
+        long long turns = total.turns;
+        auto now = chrono::steady_clock::now();
+        double elapsed = chrono::duration<double>(now - lastSample).count();
+        if (elapsed >= 0.25) { // Rate over the last sample period
+            turnsPerSec = (turns - lastTurns) / elapsed;
+            lastTurns = turns;
+            lastSample = now;
+        }
+
+        ostringstream out;
+        auto metric = [&](const char* name, const char* type, const char* help, double value) {
+            out << "# HELP robotwar_" << name << " " << help << "\n# TYPE robotwar_" << name << " " << type << "\n"
+                << "robotwar_" << name << " " << fixed << setprecision(value == (long long)value ? 0 : 2) << value << "\n";
+        };
+        metric("uptime_seconds", "gauge", "Seconds since the sampler started",
+               chrono::duration<double>(now - started).count());
+        metric("turns_total", "counter", "Turns completed", turns);
+        metric("turns_per_second", "gauge", "Turns completed per second recently", turnsPerSec);
+        metric("robots_alive", "gauge", "Living robots in each thread's current game", alive);
+        metric("respawn_queue", "gauge", "Robots waiting to respawn", queue);
+        metric("shots_total", "counter", "Shots fired", total.shots);
+        metric("hits_total", "counter", "Shots that hit", total.hits);
+        metric("log_bytes_total", "counter", "Bytes of log and event output written", total.logBytes);
+        if (ALLOC_COUNTING_ENABLED) {
+            metric("allocations_total", "counter", "Heap allocations by game threads", total.allocations);
+        }
+        metric("respawn_attempts_total", "counter", "Cells tried while placing respawns", total.respawnTries);
+
+        long long nowNs = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch()).count();
+        out << "# HELP robotwar_thread_turns_total Turns completed per running thread\n# TYPE robotwar_thread_turns_total counter\n";
+        for (const ThreadRow& t : threads) {
+            out << "robotwar_thread_turns_total{thread=\"" << t.id << "\"} " << t.turns << "\n";
+        }
+        out << "# HELP robotwar_thread_seconds_since_turn Time since a running thread last finished a turn\n"
+            << "# TYPE robotwar_thread_seconds_since_turn gauge\n";
+        for (const ThreadRow& t : threads) {
+            if (t.lastTurnNs == 0) continue;
+            out << "robotwar_thread_seconds_since_turn{thread=\"" << t.id << "\"} " << fixed << setprecision(3)
+                << (nowNs - t.lastTurnNs) / 1e9 << "\n";
+        }
+        out << "# HELP robotwar_thread_in_respawn_search 1 while the thread is looking for a free respawn cell\n"
+            << "# TYPE robotwar_thread_in_respawn_search gauge\n";
+        for (const ThreadRow& t : threads) {
+            out << "robotwar_thread_in_respawn_search{thread=\"" << t.id << "\"} " << t.inRespawnSearch << "\n";
+        }
+        return out.str();
+    }
+};
+
+// --serve <socket> [workers] [queue depth]
+int runServeMode(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: --serve <socket> [workers] [queue depth]" << endl;
+        return 1;
+    }
+    int workers = argc > 3 ? atoi(argv[3]) : (int)thread::hardware_concurrency();
+    int depth = argc > 4 ? atoi(argv[4]) : 64;
+    SimServer server(argv[2], workers, depth);
+    return server.run();
+}
+
+// --client <socket> <setup|shutdown> [summary|events] [seed]
+// Sends one request to a running server and prints the reply
+int runClientMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --client <socket> <setup|shutdown> [summary|events] [seed]" << endl;
+        return 1;
+    }
+    string path = argv[2], what = argv[3];
+    string mode = argc > 4 ? argv[4] : "summary";
+
+    string request;
+    if (what == "shutdown") {
+        request = "SHUTDOWN\nEND\n";
+    } else {
+        ifstream setup(what);
+        if (!setup) {
+            cerr << "Failed to open " << what << endl;
+            return 1;
+        }
+        ostringstream text;
+        text << "RUN " << mode;
+        if (argc > 5) text << " " << argv[5];
+        text << "\n" << setup.rdbuf() << "\nEND\n";
+        request = text.str();
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        cerr << "Cannot connect to " << path << endl;
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    sendText(fd, request);
+    shutdown(fd, SHUT_WR);
+
+    string reply;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) reply.append(buf, n);
+    close(fd);
+
+    if (reply.compare(0, 7, "OK\nRWEV") != 0) {
+        cout << reply;
+        return reply.compare(0, 2, "OK") == 0 ? 0 : 1;
+    }
+
+    // Decode event records, naming robots from the setup we sent
+    vector<string> names;
+    if (what != "shutdown") {
+        ifstream setup(what);
+        GameSetup config;
+        readSetup(setup, config);
+        for (const RobotEntry& entry : config.entries) names.push_back(entry.name);
+    }
+    auto nameOf = [&](int id) { return id >= 0 && id < (int)names.size() ? names[id] : (id < 0 ? string("-") : to_string(id)); };
+    cout << "OK" << endl;
+    for (size_t pos = 11; pos + EVENT_RECORD_SIZE <= reply.size(); pos += EVENT_RECORD_SIZE) {
+        const char* record = reply.data() + pos;
+        int32_t turn, value;
+        int16_t fields[4];
+        memcpy(&turn, record, 4);
+        memcpy(fields, record + 8, sizeof(fields));
+        memcpy(&value, record + 16, 4);
+        unsigned char type = record[4];
+        if (type >= EV_COUNT) break;
+        cout << turn << " " << EVENT_NAMES[type] << " " << nameOf(fields[0]) << " " << nameOf(fields[1])
+             << " (" << fields[2] << "," << fields[3] << ") kind=" << (int)(unsigned char)record[5]
+             << " hit=" << (int)record[6] << " value=" << value << "\n";
+    }
+    return 0;
+}
+
+// MULTI-GAME RUNNER
+// Plays many seeded games in parallel with narration switched off.
+// Results come back in seed order, so they do not depend on thread count.
+struct GameOutcome {
+    unsigned seed = 0;
+    int turns = 0;
+    string winner;           // empty if drawn
+    bool stalemate = false;  // ended early with nothing happening
+    vector<int> kills, deaths; // per robot, setup order
+};
+
+// Sole survivor wins; if the turn limit hits first, the living robot with
+// the most kills wins, and a tie is a draw
+GameOutcome summarizeGame(const Game& game, unsigned seed) {
+    GameOutcome outcome;
+    outcome.seed = seed;
+    outcome.turns = game.turn - 1;
+    outcome.stalemate = game.stalemate;
+    Robot* best = nullptr;
+    bool tied = false;
+    for (Robot* r : game.robots) {
+        outcome.kills.push_back(r->kills);
+        outcome.deaths.push_back(r->deaths);
+        if (!r->isAlive()) continue;
+        if (!best || r->kills > best->kills) { best = r; tied = false; }
+        else if (r->kills == best->kills) tied = true;
+    }
+    if (best && !tied) outcome.winner = best->name;
+    return outcome;
+}
+
+// Plays seeds [firstSeed, firstSeed + count); heatmap counters from every
+// thread are merged into heat if given
+vector<GameOutcome> runGames(const GameSetup& config, unsigned firstSeed, int count, int numThreads,
+                             Heatmap* heat = nullptr) {
+    vector<GameOutcome> outcomes(max(0, count));
+    atomic<int> nextGame(0);
+    mutex heatLock;
+    auto worker = [&]() {
+        Heatmap local;
+        Game game; // No sinks: games are played silently
+        if (heat && HEATMAPS_ENABLED) {
+            local.resize(config.width, config.height);
+            game.heat = &local;
+        }
+        for (int i = nextGame++; i < count; i = nextGame++) {
+            game.setup(config, firstSeed + i);
+            game.play();
+            outcomes[i] = summarizeGame(game, firstSeed + i);
+        }
+        game.clear();
+        if (game.heat) {
+            lock_guard<mutex> lock(heatLock);
+            heat->merge(local);
+        }
+    };
+    vector<thread> workers;
+    for (int t = 0; t < max(1, numThreads); ++t) workers.emplace_back(worker);
+    for (thread& w : workers) w.join();
+    return outcomes;
+}
+
+// Does this robot name or setup type match the selector?
+bool robotMatches(const GameSetup& config, const string& robotName, const string& selector) {
+    if (robotName == selector) return true;
+    for (const RobotEntry& entry : config.entries) {
+        if (entry.name == robotName) return entry.type == selector;
+    }
+    return false;
+}
+
+// Normal quantile (Acklam's approximation), for z scores from alpha
+double normalQuantile(double p) {
+    static const double a[] = { -39.69683028665376, 220.9460984245205, -275.9285104469687,
+                                138.3577518672690, -30.66479806614716, 2.506628277459239 };
+    static const double b[] = { -54.47609879822406, 161.5858368580409, -155.6989798598866,
+                                66.80131188771972, -13.28068155288572 };
+    static const double c[] = { -0.007784894002430293, -0.3223964580411365, -2.400758277161838,
+                                -2.549732539343734, 4.374664141464968, 2.938163982698783 };
+    static const double d[] = { 0.007784695709041462, 0.3224671290700398, 2.445134137142996,
+                                3.754408661907416 };
+    if (p <= 0) return -1e9;
+    if (p >= 1) return 1e9;
+    double q, r;
+    if (p < 0.02425) {
+        q = sqrt(-2 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - 0.02425) return -normalQuantile(1 - p);
+    q = p - 0.5;
+    r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+// Wilson score interval for wins out of n
+void wilsonInterval(int wins, int n, double z, double& low, double& high) {
+    double p = (double)wins / n, z2 = z * z;
+    double centre = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double half = z * sqrt(p * (1 - p) / n + z2 / (4.0 * n * n)) / (1 + z2 / n);
+    low = centre - half;
+    high = centre + half;
+}
+
+// Beta(1 + wins, 1 + losses) posterior, normal approximation
+void bayesInterval(int wins, int n, double z, double& low, double& high) {
+    double a = 1 + wins, b = 1 + n - wins;
+    double mean = a / (a + b);
+    double sd = sqrt(a * b / ((a + b) * (a + b) * (a + b + 1)));
+    low = max(0.0, mean - z * sd);
+    high = min(1.0, mean + z * sd);
+}
+
+// key=value options after the positional arguments
+map<string, string> parseOptions(int argc, char* argv[], int first) {
+    map<string, string> options;
+    for (int i = first; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq != string::npos) options[arg.substr(0, eq)] = arg.substr(eq + 1);
+    }
+    return options;
+}
+
+string optionOr(const map<string, string>& options, const string& key, const string& fallback) {
+    auto it = options.find(key);
+    return it == options.end() ? fallback : it->second;
+}
+
+// --experiment winrate <setup> <robot> [precision=] [method=wilson|bayes] [confidence=] [max=] [seed=] [threads=]
+// --experiment sprt <setup> <robotA> <robotB> [delta=] [alpha=] [beta=] [max=] [seed=] [threads=]
+// Plays games until the answer is known well enough, then says how many
+// games a fixed-size run would have needed
+int runExperimentMode(int argc, char* argv[]) {
+    string kind = argc > 2 ? argv[2] : "";
+    bool sprt = kind == "sprt";
+    int positional = sprt ? 6 : 5;
+    if ((kind != "winrate" && !sprt) || argc < positional) {
+        cerr << "Usage: --experiment winrate <setup> <robot> [precision=0.05] [method=wilson|bayes] [confidence=0.95]\n"
+             << "       --experiment sprt <setup> <robotA> <robotB> [delta=0.1] [alpha=0.05] [beta=0.05]\n"
+             << "       common: [max=10000] [seed=1] [threads=N]" << endl;
+        return 1;
+    }
+    ifstream setup(argv[3]);
+    if (!setup) {
+        cerr << "Failed to open " << argv[3] << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    string robotA = argv[4], robotB = sprt ? argv[5] : "";
+
+    map<string, string> options = parseOptions(argc, argv, positional);
+    int maxGames = stoi(optionOr(options, "max", "10000"));
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+    int threads = stoi(optionOr(options, "threads", to_string(max(1u, thread::hardware_concurrency()))));
+    int batchSize = max(16, threads * 8);
+
+    // Stopping rule state
+    double precision = stod(optionOr(options, "precision", "0.05"));
+    string method = optionOr(options, "method", "wilson");
+    double confidence = stod(optionOr(options, "confidence", "0.95"));
+    double z = normalQuantile(1 - (1 - confidence) / 2);
+    double delta = stod(optionOr(options, "delta", "0.1"));
+    double alpha = stod(optionOr(options, "alpha", "0.05"));
+    double beta = stod(optionOr(options, "beta", "0.05"));
+    double p0 = 0.5, p1 = 0.5 + delta; // H0: A and B even, H1: A ahead by delta
+    double lowerBound = log(beta / (1 - alpha)), upperBound = log((1 - beta) / alpha);
+    double llr = 0;
+
+    int played = 0, winsA = 0, winsB = 0, draws = 0;
+    int simulated = 0; // whole batches, including games after the rule fired
+    bool done = false;
+    string verdict = "max games reached";
+    double low = 0, high = 1;
+
+    auto start = chrono::steady_clock::now();
+    while (!done && played < maxGames) {
+        int count = min(batchSize, maxGames - played);
+        vector<GameOutcome> batch = runGames(config, firstSeed + played, count, threads);
+        simulated += (int)batch.size();
+        for (const GameOutcome& g : batch) { // Check the rule after every game, in seed order
+            played++;
+            bool aWon = !g.winner.empty() && robotMatches(config, g.winner, robotA);
+            bool bWon = sprt && !g.winner.empty() && robotMatches(config, g.winner, robotB);
+            if (aWon) winsA++;
+            else if (bWon) winsB++;
+            else draws++;
+
+            if (sprt) {
+                if (aWon) llr += log(p1 / p0);
+                else if (bWon) llr += log((1 - p1) / (1 - p0));
+                if (llr >= upperBound) { verdict = robotA + " is stronger (accept H1)"; done = true; }
+                else if (llr <= lowerBound) { verdict = "no difference of " + to_string(delta) + " (accept H0)"; done = true; }
+            } else {
+                if (method == "bayes") bayesInterval(winsA, played, z, low, high);
+                else wilsonInterval(winsA, played, z, low, high);
+                if (played >= 10 && (high - low) / 2 <= precision) { verdict = "precision reached"; done = true; }
+            }
+            if (done) break;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Games a fixed-size design would need for the same guarantee
+    int fixedGames;
+    if (sprt) {
+        double za = normalQuantile(1 - alpha), zb = normalQuantile(1 - beta);
+        double n = (za * sqrt(p0 * (1 - p0)) + zb * sqrt(p1 * (1 - p1))) / delta;
+        double decisive = played > draws ? (double)(winsA + winsB) / played : 1.0;
+        fixedGames = (int)ceil(n * n / decisive);
+    } else {
+        fixedGames = (int)ceil(z * z * 0.25 / (precision * precision)); // worst case p = 0.5
+    }
+
+    cout << "Games used: " << played << ", simulated: " << simulated << " (" << fixed << setprecision(2) << seconds
+         << "s)" << endl;
+    if (sprt) {
+        cout << robotA << " wins: " << winsA << "  " << robotB << " wins: " << winsB << "  Other/draw: " << draws << endl;
+        cout << "LLR: " << setprecision(3) << llr << " bounds [" << lowerBound << ", " << upperBound << "]" << endl;
+    } else {
+        cout << robotA << " wins: " << winsA << "/" << played << "  win rate " << setprecision(3)
+             << (double)winsA / max(1, played) << " [" << low << ", " << high << "] (" << method << ", "
+             << setprecision(0) << confidence * 100 << "%)" << endl;
+    }
+    cout << "Result: " << verdict << endl;
+    cout << "Fixed-size run would need: " << fixedGames << " games, saved "
+         << max(0, fixedGames - simulated) << endl; // Against what we actually ran
+    return 0;
+}
+
+// Plain PGM image of one layer, scaled so the busiest cell is white
+bool writeHeatmapPGM(const string& path, const Heatmap& heat, const vector<unsigned>& layer) {
+    ofstream out(path);
+    if (!out) return false;
+    unsigned peak = max(1u, layer.empty() ? 1u : *max_element(layer.begin(), layer.end()));
+    out << "P2\n" << heat.width << " " << heat.height << "\n255\n";
+    for (int y = 0; y < heat.height; ++y) {
+        for (int x = 0; x < heat.width; ++x) {
+            out << (unsigned long long)layer[y * heat.width + x] * 255 / peak << (x + 1 < heat.width ? " " : "\n");
+        }
+    }
+    return true;
+}
+
+// One row per cell with every counter
+bool writeHeatmapCSV(const string& path, const Heatmap& heat) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "x,y,occupancy,shots,hits,deaths\n";
+    for (int y = 0; y < heat.height; ++y) {
+        for (int x = 0; x < heat.width; ++x) {
+            int i = y * heat.width + x;
+            out << x << "," << y << "," << heat.occupancy[i] << "," << heat.shots[i] << ","
+                << heat.hits[i] << "," << heat.deaths[i] << "\n";
+        }
+    }
+    return true;
+}
+
+// --heatmap <setup> [games=100] [prefix=heat] [seed=1] [threads=N]
+// Plays many games and writes <prefix>_<layer>.pgm plus <prefix>.csv
+int runHeatmapMode(int argc, char* argv[]) {
+    if (!HEATMAPS_ENABLED) {
+        cerr << "Heatmaps are compiled out, rebuild with -DROBOTWAR_HEATMAP" << endl;
+        return 1;
+    }
+    if (argc < 3) {
+        cerr << "Usage: --heatmap <setup> [games=100] [prefix=heat] [seed=1] [threads=N]" << endl;
+        return 1;
+    }
+    ifstream setup(argv[2]);
+    if (!setup) {
+        cerr << "Failed to open " << argv[2] << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    map<string, string> options = parseOptions(argc, argv, 3);
+    int games = stoi(optionOr(options, "games", "100"));
+    string prefix = optionOr(options, "prefix", "heat");
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+    int threads = stoi(optionOr(options, "threads", to_string(max(1u, thread::hardware_concurrency()))));
+
+    Heatmap heat;
+    heat.resize(config.width, config.height);
+    runGames(config, firstSeed, games, threads, &heat);
+
+    bool ok = writeHeatmapPGM(prefix + "_occupancy.pgm", heat, heat.occupancy) &&
+              writeHeatmapPGM(prefix + "_shots.pgm", heat, heat.shots) &&
+              writeHeatmapPGM(prefix + "_hits.pgm", heat, heat.hits) &&
+              writeHeatmapPGM(prefix + "_deaths.pgm", heat, heat.deaths) &&
+              writeHeatmapCSV(prefix + ".csv", heat);
+    if (!ok) {
+        cerr << "Failed to write heatmaps with prefix " << prefix << endl;
+        return 1;
+    }
+    cout << "Wrote heatmaps for " << games << " games to " << prefix << "_*.pgm and " << prefix << ".csv" << endl;
+    return 0;
+}
+
+// --record <setup> <events.bin> [seed]
+// Plays one game into a binary event file and prints per-robot stats
+int runRecordMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --record <setup> <events.bin> [seed]" << endl;
+        return 1;
+    }
+    ifstream setup(argv[2]);
+    if (!setup) {
+        cerr << "Failed to open " << argv[2] << endl;
+        return 1;
+    }
+    ofstream out(argv[3], ios::binary);
+    if (!out) {
+        cerr << "Failed to create " << argv[3] << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    unsigned seed = argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 10)
+                             : (config.hasSeed ? config.seed : (unsigned)time(0));
+
+    Game game;
+    BinaryRecorder recorder(out);
+    StatsAggregator stats;
+    game.bus.attach(&recorder);
+    game.bus.attach(&stats);
+    game.setup(config, seed);
+    game.play();
+
+    long long total = 0;
+    for (long long c : stats.eventCounts) total += c;
+    cout << "Seed " << seed << ": " << game.turn - 1 << " turns, " << total << " events written to " << argv[3] << endl;
+    stats.print(cout, game.robots);
+    return 0;
+}
+
+// --hashes <setup> <out.txt> [seed=1] [games=1] [threads=1] [check=0]
+// Writes "seed turn hash" for every turn of every game (turn 0 = start).
+// check=1 also recomputes each hash from scratch to test the incremental one.
+int runHashesMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --hashes <setup> <out.txt> [seed=1] [games=1] [threads=1] [check=0]" << endl;
+        return 1;
+    }
+    ifstream setup(argv[2]);
+    if (!setup) {
+        cerr << "Failed to open " << argv[2] << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    map<string, string> options = parseOptions(argc, argv, 4);
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+    int games = max(1, stoi(optionOr(options, "games", "1")));
+    int threads = max(1, stoi(optionOr(options, "threads", "1")));
+    bool check = optionOr(options, "check", "0") == "1";
+
+    vector<vector<unsigned long long>> streams(games);
+    atomic<int> nextGame(0), badTurns(0);
+    auto worker = [&]() {
+        Game game;
+        for (int i = nextGame++; i < games; i = nextGame++) {
+            game.setup(config, firstSeed + i);
+            streams[i].push_back(game.hash);
+            while (game.playTurn()) {
+                streams[i].push_back(game.hash);
+                if (check && game.hash != game.fullHash()) badTurns++;
+            }
+        }
+    };
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+    for (thread& w : workers) w.join();
+
+    ofstream out(argv[3]);
+    if (!out) {
+        cerr << "Failed to create " << argv[3] << endl;
+        return 1;
+    }
+    long long lines = 0;
+    for (int i = 0; i < games; ++i) {
+        for (size_t turn = 0; turn < streams[i].size(); ++turn, ++lines) {
+            out << firstSeed + i << " " << turn << " " << hex << setw(16) << setfill('0') << streams[i][turn]
+                << dec << setfill(' ') << "\n";
+        }
+    }
+    cout << "Wrote " << lines << " turn hashes for " << games << " games to " << argv[3] << endl;
+    if (check) {
+        cout << (badTurns ? "Incremental hash drifted on " + to_string(badTurns) + " turns"
+                          : string("Incremental hash matches full recompute")) << endl;
+    }
+    return badTurns ? 2 : 0;
+}
+
+// --verify <a.txt> <b.txt>
+// Compares two hash streams and reports the first turn where they split
+int runVerifyMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --verify <a.txt> <b.txt>" << endl;
+        return 1;
+    }
+    ifstream a(argv[2]), b(argv[3]);
+    if (!a || !b) {
+        cerr << "Failed to open " << (!a ? argv[2] : argv[3]) << endl;
+        return 1;
+    }
+    string lineA, lineB;
+    long long compared = 0;
+    while (true) {
+        bool moreA = (bool)getline(a, lineA), moreB = (bool)getline(b, lineB);
+        if (!moreA && !moreB) break;
+        if (moreA != moreB) {
+            cout << "Streams differ in length after " << compared << " turns; "
+                 << (moreA ? argv[2] : argv[3]) << " continues with: " << (moreA ? lineA : lineB) << endl;
+            return 2;
+        }
+        if (lineA != lineB) {
+            istringstream wordsA(lineA), wordsB(lineB);
+            string seed, turn, hashA, hashB;
+            wordsA >> seed >> turn >> hashA;
+            wordsB >> seed >> seed >> hashB; // only need b's hash
+            cout << "First difference: seed " << lineA.substr(0, lineA.find(' ')) << " turn " << turn
+                 << " (" << hashA << " vs " << hashB << ")" << endl;
+            return 2;
+        }
+        compared++;
+    }
+    cout << "Hash streams match (" << compared << " turns)" << endl;
+    return 0;
+}
+
+// LOG ANALYTICS
+// --ingest memory-maps text logs, cuts them at "----- Turn N -----" headers
+// and parses the pieces on worker threads into one event table. The table is
+// stored column by column, sorted by (type, turn), in a small index file.
+// --query maps that file and answers with a binary search plus a filter, so
+// it never touches the original logs.
+enum LogEventType : unsigned char {
+    LOG_SHOT, LOG_HIT, LOG_KILL, LOG_SELF_DESTRUCT, LOG_UPGRADE,
+    LOG_MOVE, LOG_JUMP, LOG_RESPAWN, LOG_HIDE, LOG_TYPE_COUNT,
+    LOG_STATUS = 255 // only used while ingesting
+};
+const char* const LOG_EVENT_NAMES[] = {
+    "shot", "hit", "kill", "selfdestruct", "upgrade", "move", "jump", "respawn", "hide"
+};
+
+struct RawLogEvent {
+    int32_t turn;
+    unsigned char type;
+    int32_t actor, target; // name ids, -1 if none
+    int32_t extra;         // shot: 1 hit / 0 miss / 2 burst; upgrade: UpgradeKind; status: upgrade mask
+};
+
+// One piece of a log, starting at a turn header
+struct LogChunk {
+    const char* begin;
+    const char* end;
+    vector<RawLogEvent> events;
+    vector<string_view> names; // local name ids
+    unordered_map<string_view, int> nameIds;
+
+    int nameId(string_view name) {
+        auto it = nameIds.find(name);
+        if (it != nameIds.end()) return it->second;
+        names.push_back(name);
+        return nameIds[name] = (int)names.size() - 1;
+    }
+};
+
+inline bool startsWith(string_view s, string_view prefix) { return s.compare(0, prefix.size(), prefix) == 0; }
+inline bool endsWith(string_view s, string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int upgradeIndex(string_view name) {
+    for (int i = 0; i < (int)(sizeof(UPGRADE_NAMES) / sizeof(UPGRADE_NAMES[0])); ++i) {
+        if (name == UPGRADE_NAMES[i]) return i;
+    }
+    return -1;
+}
+
+// Turn the text of one chunk into raw events
+void parseLogChunk(LogChunk& chunk) {
+    int turn = 0, lastShooter = -1, patternShooter = -1;
+    bool inStatus = false;
+    auto add = [&](unsigned char type, int actor, int target, int extra) {
+        chunk.events.push_back({ turn, type, actor, target, extra });
+    };
+
+    for (const char* p = chunk.begin; p < chunk.end;) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+        if (!eol) eol = chunk.end;
+        string_view line(p, eol - p);
+        p = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) { inStatus = false; continue; }
+        if (line[0] == '*') continue; // Map rows
+
+        size_t at;
+        if (startsWith(line, "----- Turn ")) {
+            turn = atoi(line.data() + 11);
+            inStatus = false;
+        } else if (startsWith(line, "--- Status")) {
+            inStatus = true;
+        } else if (inStatus && (at = line.find(" at (")) != string_view::npos) {
+            // "Name at (x,y) HP=... | Upgrades: JumpBot(2) SemiAutoBot  [DEAD]"
+            int mask = 0;
+            size_t up = line.find("| Upgrades:");
+            if (up != string_view::npos) {
+                string_view rest = line.substr(up + 11);
+                while (!rest.empty()) {
+                    size_t start = rest.find_first_not_of(' ');
+                    if (start == string_view::npos) break;
+                    rest.remove_prefix(start);
+                    size_t stop = rest.find_first_of(" (");
+                    int kind = upgradeIndex(rest.substr(0, stop));
+                    if (kind >= 0) mask |= 1 << kind;
+                    stop = rest.find(' ');
+                    if (stop == string_view::npos) break;
+                    rest.remove_prefix(stop);
+                }
+            }
+            add(LOG_STATUS, chunk.nameId(line.substr(0, at)), -1, mask);
+        } else if ((at = line.find(" (SemiAutoBot) fires 3 shots at ")) != string_view::npos) {
+            // Hit messages for the first shot can follow on the same line
+            int actor = chunk.nameId(line.substr(0, at));
+            string_view rest = line.substr(at + 32);
+            size_t bang = rest.find('!');
+            int target = chunk.nameId(rest.substr(0, bang));
+            lastShooter = actor;
+            add(LOG_SHOT, actor, target, 2);
+            if (rest.find(" is hit! (Health=") != string_view::npos) add(LOG_HIT, target, actor, 0);
+        } else if ((at = line.find(" (LongShotBot) fires at ")) != string_view::npos) {
+            int actor = chunk.nameId(line.substr(0, at));
+            string_view rest = line.substr(at + 24);
+            lastShooter = actor;
+            add(LOG_SHOT, actor, chunk.nameId(rest.substr(0, rest.find(" (dist="))), endsWith(line, "HIT!"));
+        } else if (startsWith(line, "  Targeting ")) {
+            string_view rest = line.substr(12);
+            lastShooter = patternShooter;
+            add(LOG_SHOT, patternShooter, chunk.nameId(rest.substr(0, rest.find(" at ("))), endsWith(line, "HIT!"));
+        } else if ((at = line.find(" fires in ")) != string_view::npos ||
+                   (at = line.find(" fires across two rows!")) != string_view::npos) {
+            patternShooter = chunk.nameId(line.substr(0, at));
+        } else if ((at = line.find(" fires at ")) != string_view::npos) {
+            int actor = chunk.nameId(line.substr(0, at));
+            string_view rest = line.substr(at + 10);
+            lastShooter = actor;
+            add(LOG_SHOT, actor, chunk.nameId(rest.substr(0, rest.find("... "))), endsWith(line, "HIT!"));
+        } else if ((at = line.find(" is hit! (Health=")) != string_view::npos) {
+            add(LOG_HIT, chunk.nameId(line.substr(2, at - 2)), lastShooter, 0);
+        } else if (endsWith(line, " is destroyed!")) {
+            add(LOG_KILL, lastShooter, chunk.nameId(line.substr(2, line.size() - 16)), 0);
+        } else if (endsWith(line, " self-destructs!")) {
+            add(LOG_SELF_DESTRUCT, chunk.nameId(line.substr(0, line.size() - 16)), -1, 0);
+        } else if ((at = line.find(" upgraded to ")) != string_view::npos) {
+            string_view name = line.substr(at + 13);
+            if (!name.empty() && name.back() == '.') name.remove_suffix(1);
+            add(LOG_UPGRADE, chunk.nameId(line.substr(0, at)), -1, upgradeIndex(name));
+        } else if ((at = line.find(" jumps to (")) != string_view::npos) {
+            size_t near = line.find(" near ");
+            add(LOG_JUMP, chunk.nameId(line.substr(0, at)),
+                near == string_view::npos ? -1 : chunk.nameId(line.substr(near + 6)), 0);
+        } else if ((at = line.find(" respawns at (")) != string_view::npos) {
+            add(LOG_RESPAWN, chunk.nameId(line.substr(0, at)), -1, 0);
+        } else if ((at = line.find(" moves toward ")) != string_view::npos) {
+            string_view rest = line.substr(at + 14);
+            add(LOG_MOVE, chunk.nameId(line.substr(0, at)), chunk.nameId(rest.substr(0, rest.find(" to ("))), 0);
+        } else if ((at = line.find(" moves to (")) != string_view::npos) {
+            add(LOG_MOVE, chunk.nameId(line.substr(0, at)), -1, 0);
+        } else if ((at = line.find(" (HideBot) is hidden")) != string_view::npos ||
+                   (at = line.find(" is hidden and invulnerable")) != string_view::npos) {
+            add(LOG_HIDE, chunk.nameId(line.substr(0, at)), -1, 0);
+        }
+    }
+}
+
+// Read-only memory map of a whole file
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<const char*>(p);
+                size = st.st_size;
+            }
+        }
+        ::close(fd);
+        return data != nullptr || st.st_size == 0;
+    }
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+};
+
+// Index file layout (native byte order):
+//   "RWIX" u32 version, u64 rows, u32 names, u32 files
+//   columns, each rows long: i32 turn, u8 type (padded to 8), i32 actor,
+//   i32 target, i32 extra, u32 actor upgrade mask, u16 file (padded to 8)
+//   then names and file paths as u32 length + bytes
+// Rows are sorted by (type, turn, file).
+struct LogIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t rows;
+    uint32_t names, files;
+};
+
+inline size_t padTo8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// --ingest <index> <log>... [threads=N]
+int runIngestMode(int argc, char* argv[]) {
+    vector<string> paths;
+    int threads = max(1u, thread::hardware_concurrency());
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (startsWith(arg, "threads=")) threads = max(1, atoi(arg.c_str() + 8));
+        else paths.push_back(arg);
+    }
+    if (argc < 4 || paths.empty()) {
+        cerr << "Usage: --ingest <index> <log>... [threads=N]" << endl;
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+
+    // Map files and cut each into pieces at turn headers
+    vector<MappedFile> files(paths.size());
+    vector<LogChunk> chunks;
+    vector<int> chunkFile;
+    size_t totalBytes = 0;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        if (!files[f].open(paths[f])) {
+            cerr << "Failed to open " << paths[f] << endl;
+            return 1;
+        }
+        const char* data = files[f].data;
+        size_t size = files[f].size;
+        totalBytes += size;
+        size_t pieces = max<size_t>(1, min<size_t>(threads * 4, size / (1 << 16)));
+        size_t from = 0;
+        for (size_t k = 1; k <= pieces && from < size; ++k) {
+            size_t to = k == pieces ? size : size * k / pieces;
+            if (to < size) { // Move the cut forward to the next turn header
+                string_view rest(data + to, size - to);
+                size_t header = rest.find("\n----- Turn ");
+                to = header == string_view::npos ? size : to + header + 1;
+            }
+            if (to <= from) continue;
+            LogChunk chunk;
+            chunk.begin = data + from;
+            chunk.end = data + to;
+            chunks.push_back(move(chunk));
+            chunkFile.push_back((int)f);
+            from = to;
+        }
+    }
+
+    // Parse pieces in parallel
+    atomic<size_t> nextChunk(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) parseLogChunk(chunks[c]);
+        });
+    }
+    for (thread& w : workers) w.join();
+
+    // Merge names, then walk each file in order to know every robot's
+    // upgrades at the moment of each event
+    vector<string> names;
+    unordered_map<string, int> globalIds;
+    vector<int32_t> colTurn, colActor, colTarget, colExtra;
+    vector<unsigned char> colType;
+    vector<uint32_t> colMask;
+    vector<uint16_t> colFile;
+    vector<uint32_t> masks;
+    int currentFile = -1;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        LogChunk& chunk = chunks[c];
+        if (chunkFile[c] != currentFile) {
+            currentFile = chunkFile[c];
+            fill(masks.begin(), masks.end(), 0);
+        }
+        vector<int> remap(chunk.names.size());
+        for (size_t i = 0; i < chunk.names.size(); ++i) {
+            string name(chunk.names[i]);
+            auto it = globalIds.find(name);
+            if (it == globalIds.end()) {
+                it = globalIds.emplace(name, (int)names.size()).first;
+                names.push_back(name);
+            }
+            remap[i] = it->second;
+        }
+        masks.resize(names.size(), 0);
+        for (const RawLogEvent& e : chunk.events) {
+            int actor = e.actor >= 0 ? remap[e.actor] : -1;
+            int target = e.target >= 0 ? remap[e.target] : -1;
+            if (e.type == LOG_STATUS) {
+                masks[actor] = e.extra;
+                continue;
+            }
+            // Firing or hiding with a named weapon proves the upgrade
+            if (e.type == LOG_SHOT && e.extra == 2 && actor >= 0) masks[actor] |= 1 << UP_SEMIAUTOBOT;
+            if (e.type == LOG_HIDE && actor >= 0) masks[actor] |= 1 << UP_HIDEBOT;
+            colTurn.push_back(e.turn);
+            colType.push_back(e.type);
+            colActor.push_back(actor);
+            colTarget.push_back(target);
+            colExtra.push_back(e.extra);
+            colMask.push_back(actor >= 0 ? masks[actor] : 0);
+            colFile.push_back((uint16_t)chunkFile[c]);
+            if (e.type == LOG_UPGRADE && actor >= 0 && e.extra >= 0) masks[actor] |= 1 << e.extra;
+        }
+    }
+
+    // Sort rows by (type, turn, file), keeping log order otherwise
+    size_t rows = colTurn.size();
+    vector<uint32_t> order(rows);
+    for (size_t i = 0; i < rows; ++i) order[i] = (uint32_t)i;
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (colType[a] != colType[b]) return colType[a] < colType[b];
+        if (colTurn[a] != colTurn[b]) return colTurn[a] < colTurn[b];
+        return colFile[a] < colFile[b];
+    });
+
+    ofstream out(argv[2], ios::binary);
+    if (!out) {
+        cerr << "Failed to create " << argv[2] << endl;
+        return 1;
+    }
+    LogIndexHeader header = { { 'R', 'W', 'I', 'X' }, 1, rows, (uint32_t)names.size(), (uint32_t)paths.size() };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    auto writeColumn = [&](const auto& column) {
+        using T = typename decay_t<decltype(column)>::value_type;
+        vector<T> sorted(rows);
+        for (size_t i = 0; i < rows; ++i) sorted[i] = column[order[i]];
+        out.write(reinterpret_cast<const char*>(sorted.data()), rows * sizeof(T));
+        static const char zeros[8] = {};
+        out.write(zeros, padTo8(rows * sizeof(T)) - rows * sizeof(T));
+    };
+    writeColumn(colTurn);
+    writeColumn(colType);
+    writeColumn(colActor);
+    writeColumn(colTarget);
+    writeColumn(colExtra);
+    writeColumn(colMask);
+    writeColumn(colFile);
+    auto writeString = [&](const string& s) {
+        uint32_t len = (uint32_t)s.size();
+        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        out.write(s.data(), len);
+    };
+    for (const string& name : names) writeString(name);
+    for (const string& path : paths) writeString(path);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Indexed " << rows << " events from " << paths.size() << " logs (" << totalBytes / 1024 << " KB, "
+         << chunks.size() << " pieces) in " << fixed << setprecision(3) << seconds << "s" << endl;
+    return 0;
+}
+
+// --query <index> <type> [upgrade=Name] [after=N] [before=N] [actor=Name] [target=Name] [list=N]
+// e.g. --query logs.idx kill upgrade=SemiAutoBot after=100
+int runQueryMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --query <index> <shot|hit|kill|selfdestruct|upgrade|move|jump|respawn|hide>"
+             << " [upgrade=Name] [after=N] [before=N] [actor=Name] [target=Name] [list=N]" << endl;
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    MappedFile index;
+    if (!index.open(argv[2]) || index.size < sizeof(LogIndexHeader) || memcmp(index.data, "RWIX", 4) != 0) {
+        cerr << "Not an index file: " << argv[2] << endl;
+        return 1;
+    }
+    LogIndexHeader header;
+    memcpy(&header, index.data, sizeof(header));
+    size_t rows = header.rows;
+
+    // Check the header against the file before trusting any offsets in it
+    const char* end = index.data + index.size;
+    size_t available = index.size - sizeof(header);
+    bool intact = rows <= available / 23; // every row takes at least 23 bytes
+    if (intact) {
+        size_t columnBytes = 5 * padTo8(rows * 4) + padTo8(rows) + padTo8(rows * 2);
+        intact = columnBytes <= available && (available - columnBytes) / 4 >= (size_t)header.names + header.files;
+    }
+    if (!intact) {
+        cerr << "Index is truncated or corrupt: " << argv[2] << endl;
+        return 1;
+    }
+
+    // Column pointers straight into the mapping
+    const char* p = index.data + sizeof(header);
+    auto column = [&](size_t width) {
+        const char* c = p;
+        p += padTo8(rows * width);
+        return c;
+    };
+    const int32_t* turns = reinterpret_cast<const int32_t*>(column(4));
+    const unsigned char* types = reinterpret_cast<const unsigned char*>(column(1));
+    const int32_t* actors = reinterpret_cast<const int32_t*>(column(4));
+    const int32_t* targets = reinterpret_cast<const int32_t*>(column(4));
+    const int32_t* extras = reinterpret_cast<const int32_t*>(column(4));
+    const uint32_t* masks = reinterpret_cast<const uint32_t*>(column(4));
+    const uint16_t* fileIds = reinterpret_cast<const uint16_t*>(column(2));
+    vector<string> names, paths;
+    auto readString = [&](string& s) {
+        uint32_t len;
+        if ((size_t)(end - p) < sizeof(len)) return false;
+        memcpy(&len, p, sizeof(len));
+        if ((size_t)(end - p) - sizeof(len) < len) return false;
+        s.assign(p + sizeof(len), len);
+        p += sizeof(len) + len;
+        return true;
+    };
+    names.resize(header.names);
+    paths.resize(header.files);
+    for (string& s : names) intact = intact && readString(s);
+    for (string& s : paths) intact = intact && readString(s);
+    if (!intact) {
+        cerr << "Index is truncated or corrupt: " << argv[2] << endl;
+        return 1;
+    }
+
+    int type = -1;
+    for (int t = 0; t < LOG_TYPE_COUNT; ++t) {
+        if (argv[3] == string(LOG_EVENT_NAMES[t])) type = t;
+    }
+    if (type < 0) {
+        cerr << "Unknown event type " << argv[3] << endl;
+        return 1;
+    }
+    map<string, string> options = parseOptions(argc, argv, 4);
+    int after = stoi(optionOr(options, "after", "-1"));
+    int before = stoi(optionOr(options, "before", to_string(INT_MAX)));
+    int list = stoi(optionOr(options, "list", "0"));
+    uint32_t needMask = 0;
+    if (options.count("upgrade")) {
+        int kind = upgradeIndex(options["upgrade"]);
+        if (kind < 0) {
+            cerr << "Unknown upgrade " << options["upgrade"] << endl;
+            return 1;
+        }
+        needMask = 1u << kind;
+    }
+    auto nameFilter = [&](const string& key) {
+        if (!options.count(key)) return -2; // no filter
+        auto it = find(names.begin(), names.end(), options[key]);
+        return it == names.end() ? -3 : (int)(it - names.begin()); // -3 matches nothing
+    };
+    int wantActor = nameFilter("actor"), wantTarget = nameFilter("target");
+
+    // Rows are sorted by (type, turn): binary search the range, then filter
+    auto lowerBound = [&](int turn) {
+        size_t lo = 0, hi = rows;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (types[mid] < type || (types[mid] == type && turns[mid] < turn)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    };
+    size_t lo = lowerBound(after + 1), hi = lowerBound(before);
+
+    long long matches = 0;
+    for (size_t i = lo; i < hi; ++i) {
+        if ((masks[i] & needMask) != needMask) continue;
+        if (wantActor != -2 && actors[i] != wantActor) continue;
+        if (wantTarget != -2 && targets[i] != wantTarget) continue;
+        if (matches++ < list) {
+            // Ids come from the file too, so range check them
+            auto nameOf = [&](int id) { return id < 0 ? string("-") : id < (int)names.size() ? names[id] : string("?"); };
+            cout << (fileIds[i] < paths.size() ? paths[fileIds[i]] : string("?")) << " turn " << turns[i] << ": "
+                 << LOG_EVENT_NAMES[type] << " " << nameOf(actors[i]) << " -> " << nameOf(targets[i]);
+            if (type == LOG_UPGRADE && extras[i] >= 0 && extras[i] < (int)size(UPGRADE_NAMES)) {
+                cout << " (" << UPGRADE_NAMES[extras[i]] << ")";
+            }
+            cout << "\n";
+        }
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << matches << " matching " << LOG_EVENT_NAMES[type] << " events (scanned " << hi - lo << " of " << rows
+         << " rows, " << fixed << setprecision(2) << ms << " ms)" << endl;
+    return 0;
+}
+
+// --script-bench <script.bot> [robots=20] [size=20] [turns=100] [games=200] [seed=1]
+// Times the same arena full of GenericRobots and full of script robots
+int runScriptBenchMode(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: --script-bench <script.bot> [robots=20] [size=20] [turns=100] [games=200] [seed=1]" << endl;
+        return 1;
+    }
+    string script = argv[2];
+    if (!loadScript(script)) return 1;
+    map<string, string> options = parseOptions(argc, argv, 3);
+    int robots = stoi(optionOr(options, "robots", "20"));
+    int size = stoi(optionOr(options, "size", "20"));
+    int games = max(1, stoi(optionOr(options, "games", "200")));
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+
+    // Robot turns per second for an arena of one robot type
+    auto measure = [&](const string& type) {
+        GameSetup config;
+        config.width = config.height = size;
+        config.numTurns = stoi(optionOr(options, "turns", "100"));
+        for (int i = 0; i < robots; ++i) config.entries.push_back({ type, "R" + to_string(i), "random", "random" });
+        Game game;
+        long long robotTurns = 0;
+        auto start = chrono::steady_clock::now();
+        for (int g = 0; g < games; ++g) {
+            game.setup(config, firstSeed + g);
+            do {
+                robotTurns += count_if(game.robots.begin(), game.robots.end(), [](Robot* r) { return r->isAlive(); });
+            } while (game.playTurn());
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = robotTurns / seconds;
+        cout << left << setw(24) << type << right << setw(12) << robotTurns << " robot-turns" << setw(14) << fixed
+             << setprecision(0) << rate << " /sec" << endl;
+        return rate;
+    };
+    double native = measure("GenericRobot");
+    double scripted = measure(script);
+    cout << "Script speed: " << setprecision(2) << scripted / native << "x native" << endl;
+    return 0;
+}
+
+// PARAMETER SWEEPS
+// A grid file lists the values to try, one parameter per line:
+//   size: 10x10 20x20 40x40
+//   steps: 100 300
+//   robots: 5 10
+//   roster: GenericRobot,SemiAutoBot | JumpBot,HideBot,ScoutBot
+// Every combination becomes one job (robots take the roster's types in turn).
+// Jobs are split over forked worker processes. Each worker appends to its own
+// shard file, so a crash loses at most the job it was running. A restarted
+// sweep skips jobs that already have results. A job that takes its worker
+// down twice is recorded as failed (an interrupted sweep doesn't count). A
+// worker that keeps crashing between jobs is given up on after a few
+// restarts and its remaining jobs are recorded as failed.
+struct SweepJob {
+    string key; // "size=20x20 steps=100 robots=10 roster=A,B"
+    GameSetup config;
+};
+
+const int SWEEP_MAX_ATTEMPTS = 2;
+const int SWEEP_MAX_RESTARTS = 3; // crashes outside any job before a shard gives up
+
+bool readSweepGrid(const string& path, int stalemateTurns, vector<SweepJob>& jobs) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "Failed to open " << path << endl;
+        return false;
+    }
+    vector<string> sizes = { "10x10" }, steps = { "100" }, counts = { "5" }, rosters = { "GenericRobot" };
+    string line;
+    while (getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon);
+        key.erase(remove(key.begin(), key.end(), ' '), key.end());
+        vector<string> values;
+        if (key == "roster") {
+            stringstream alternatives(line.substr(colon + 1));
+            string roster;
+            while (getline(alternatives, roster, '|')) {
+                roster.erase(remove(roster.begin(), roster.end(), ' '), roster.end());
+                if (!roster.empty()) values.push_back(roster);
+            }
+        } else {
+            istringstream words(line.substr(colon + 1));
+            for (string word; words >> word;) values.push_back(word);
+        }
+        if (values.empty()) continue;
+        if (key == "size") sizes = values;
+        else if (key == "steps") steps = values;
+        else if (key == "robots") counts = values;
+        else if (key == "roster") rosters = values;
+        else {
+            cerr << "Unknown sweep parameter " << key << endl;
+            return false;
+        }
+    }
+
+    for (const string& size : sizes) {
+        for (const string& step : steps) {
+            for (const string& count : counts) {
+                for (const string& roster : rosters) {
+                    SweepJob job;
+                    job.key = "size=" + size + " steps=" + step + " robots=" + count + " roster=" + roster;
+                    if (sscanf(size.c_str(), "%dx%d", &job.config.width, &job.config.height) != 2) {
+                        cerr << "Bad size " << size << " (want WxH)" << endl;
+                        return false;
+                    }
+                    job.config.numTurns = stoi(step);
+                    job.config.stalemateTurns = stalemateTurns;
+                    if (stalemateTurns > 0) job.key += " stalemate=" + to_string(stalemateTurns);
+                    vector<string> types;
+                    stringstream list(roster);
+                    for (string type; getline(list, type, ',');) types.push_back(type);
+                    for (int i = 0; i < stoi(count); ++i) {
+                        job.config.entries.push_back({ types[i % types.size()], "R" + to_string(i), "random", "random" });
+                    }
+                    jobs.push_back(job);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Shard file lines (tab separated):
+//   begin <key>
+//   result <key> <games> <average turns> <draws> <stalemates> <type>=<wins> ...
+//   crashed <key>     (added by the parent when the worker died on it)
+//   failed <key>
+string shardPath(const string& outDir, int shard) { return outDir + "/shard-" + to_string(shard) + ".txt"; }
+
+// Every shard file in the directory, including ones from runs that used a
+// different number of workers
+vector<string> shardFiles(const string& outDir) {
+    vector<string> paths;
+    if (DIR* dir = opendir(outDir.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (startsWith(name, "shard-") && endsWith(name, ".txt")) paths.push_back(outDir + "/" + name);
+        }
+        closedir(dir);
+    }
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Runs one worker's share of the jobs (every workers-th job from shard)
+int runSweepShard(const vector<SweepJob>& jobs, const string& outDir, int shard, int workers,
+                  int games, unsigned firstSeed) {
+    // What earlier runs (of any shard) already did
+    map<string, int> crashes;
+    set<string> finished;
+    for (const string& path : shardFiles(outDir)) {
+        ifstream old(path);
+        string line;
+        while (getline(old, line)) {
+            size_t tab = line.find('\t'), end = line.find('\t', tab + 1);
+            if (tab == string::npos) continue;
+            string kind = line.substr(0, tab), key = line.substr(tab + 1, end - tab - 1);
+            if (kind == "crashed") crashes[key]++;
+            else if (kind != "begin") finished.insert(key);
+        }
+    }
+    ofstream out(shardPath(outDir, shard), ios::app);
+    for (size_t j = shard; j < jobs.size(); j += workers) {
+        const SweepJob& job = jobs[j];
+        if (finished.count(job.key)) continue;
+        if (crashes[job.key] >= SWEEP_MAX_ATTEMPTS) { // Give up on it
+            out << "failed\t" << job.key << endl;
+            continue;
+        }
+        out << "begin\t" << job.key << endl; // flushed, so a crash leaves a trace
+
+        vector<GameOutcome> outcomes = runGames(job.config, firstSeed, games, 1);
+        map<string, int> winsByType;
+        for (const RobotEntry& e : job.config.entries) winsByType[e.type] += 0;
+        long long turns = 0;
+        int draws = 0, stalemates = 0;
+        for (const GameOutcome& o : outcomes) {
+            turns += o.turns;
+            stalemates += o.stalemate;
+            if (o.winner.empty()) { draws++; continue; }
+            for (const RobotEntry& e : job.config.entries) {
+                if (e.name == o.winner) winsByType[e.type]++;
+            }
+        }
+        out << "result\t" << job.key << "\t" << games << "\t" << fixed << setprecision(1)
+            << (double)turns / games << "\t" << draws << "\t" << stalemates;
+        for (auto& [type, wins] : winsByType) out << "\t" << type << "=" << wins;
+        out << endl;
+    }
+    return 0;
+}
+
+// Collect every shard's results into one table, in grid order
+void mergeSweep(const vector<SweepJob>& jobs, const string& outDir) {
+    map<string, vector<string>> results; // key -> fields after the key
+    set<string> failed;
+    for (const string& path : shardFiles(outDir)) {
+        ifstream in(path);
+        string line;
+        while (getline(in, line)) {
+            vector<string> fields;
+            stringstream parts(line);
+            for (string field; getline(parts, field, '\t');) fields.push_back(field);
+            if (fields.size() < 2) continue;
+            if (fields[0] == "result") results[fields[1]] = vector<string>(fields.begin() + 2, fields.end());
+            else if (fields[0] == "failed") failed.insert(fields[1]);
+        }
+    }
+
+    ofstream summary(outDir + "/summary.txt");
+    auto both = [&](const string& text) {
+        cout << text;
+        summary << text;
+    };
+    size_t rosterWidth = 6;
+    for (const SweepJob& job : jobs) {
+        size_t from = job.key.find("roster=") + 7;
+        size_t to = min(job.key.find(' ', from), job.key.size());
+        rosterWidth = max(rosterWidth, to - from);
+    }
+    ostringstream header;
+    header << left << setw(10) << "size" << right << setw(7) << "steps" << setw(8) << "robots" << "  " << left
+           << setw(rosterWidth) << "roster" << right << setw(7) << "games" << setw(8) << "turns" << setw(7) << "draw%"
+           << setw(7) << "stale%" << "  win% by type\n";
+    both(header.str());
+    int missing = 0;
+    for (const SweepJob& job : jobs) {
+        ostringstream row;
+        istringstream keyWords(job.key);
+        string size, steps, robots, roster;
+        keyWords >> size >> steps >> robots >> roster;
+        row << left << setw(10) << size.substr(5) << right << setw(7) << steps.substr(6) << setw(8)
+            << robots.substr(7) << "  " << left << setw(rosterWidth) << roster.substr(7) << right;
+        auto it = results.find(job.key);
+        if (it == results.end()) {
+            row << (failed.count(job.key) ? "  FAILED (crashed its worker)" : "  missing") << "\n";
+            missing++;
+        } else {
+            const vector<string>& f = it->second;
+            int games = stoi(f[0]);
+            row << setw(7) << games << setw(8) << f[1] << setw(7) << fixed << setprecision(1)
+                << 100.0 * stoi(f[2]) / games << setw(7) << 100.0 * stoi(f[3]) / games << " ";
+            for (size_t i = 4; i < f.size(); ++i) {
+                size_t eq = f[i].find('=');
+                row << " " << f[i].substr(0, eq) << " " << setprecision(1) << 100.0 * stoi(f[i].substr(eq + 1)) / games;
+            }
+            row << "\n";
+        }
+        both(row.str());
+    }
+    cout << jobs.size() - missing << " of " << jobs.size() << " jobs done; table written to " << outDir
+         << "/summary.txt" << endl;
+}
+
+// --sweep <grid.txt> <outdir> [workers=N] [games=20] [seed=1] [stalemate=0]
+int runSweepMode(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: --sweep <grid.txt> <outdir> [workers=N] [games=20] [seed=1] [stalemate=0]" << endl;
+        return 1;
+    }
+    map<string, string> options = parseOptions(argc, argv, 4);
+    vector<SweepJob> jobs;
+    if (!readSweepGrid(argv[2], stoi(optionOr(options, "stalemate", "0")), jobs)) return 1;
+    string outDir = argv[3];
+    int workers = max(1, stoi(optionOr(options, "workers", to_string(max(1u, thread::hardware_concurrency())))));
+    int games = max(1, stoi(optionOr(options, "games", "20")));
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+    workers = min(workers, (int)jobs.size());
+    if (mkdir(outDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        cerr << "Failed to create " << outDir << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    cout << jobs.size() << " jobs x " << games << " games on " << workers << " worker processes" << endl;
+
+    // Start (or restart) one worker process per shard
+    map<pid_t, int> running;
+    auto launch = [&](int shard) {
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM); // Don't outlive an interrupted sweep
+            telemetryEnabled = false; // The sampler isn't forked and may have held telemetryLock
+            _exit(runSweepShard(jobs, outDir, shard, workers, games, firstSeed));
+        }
+        if (pid < 0) {
+            cerr << "fork failed: " << strerror(errno) << endl;
+            return false;
+        }
+        running[pid] = shard;
+        return true;
+    };
+    for (int shard = 0; shard < workers; ++shard) {
+        if (!launch(shard)) return 1;
+    }
+    map<int, int> restarts; // per shard, crashes outside any job
+    while (!running.empty()) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+        int shard = running[pid];
+        running.erase(pid);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+        // The shard file says how far it got, so the new worker carries on.
+        // Blame the job it was in the middle of.
+        ifstream shardIn(shardPath(outDir, shard));
+        string line, last;
+        while (getline(shardIn, line)) last = line;
+        shardIn.close();
+        bool inJob = startsWith(last, "begin\t");
+        if (inJob) ofstream(shardPath(outDir, shard), ios::app) << "crashed\t" << last.substr(6) << "\n";
+        if (WIFSIGNALED(status)) cout << "Worker " << shard << " killed by signal " << WTERMSIG(status);
+        else cout << "Worker " << shard << " exited with " << WEXITSTATUS(status);
+
+        // Crashes inside a job use up that job's attempts, so they always make
+        // progress. Crashes between jobs don't, so they get a cap of their own.
+        if (!inJob && ++restarts[shard] >= SWEEP_MAX_RESTARTS) {
+            cout << ", giving up on its remaining jobs" << endl;
+            set<string> done;
+            for (const string& path : shardFiles(outDir)) {
+                ifstream old(path);
+                while (getline(old, line)) {
+                    if (!startsWith(line, "result\t") && !startsWith(line, "failed\t")) continue;
+                    size_t tab = line.find('\t'), end = line.find('\t', tab + 1);
+                    done.insert(line.substr(tab + 1, end - tab - 1));
+                }
+            }
+            ofstream out(shardPath(outDir, shard), ios::app);
+            for (size_t j = shard; j < jobs.size(); j += workers) {
+                if (!done.count(jobs[j].key)) out << "failed\t" << jobs[j].key << "\n";
+            }
+            continue;
+        }
+        cout << ", restarting" << endl;
+        if (!launch(shard)) return 1;
+    }
+
+    mergeSweep(jobs, outDir);
+    return 0;
+}
+
+// TOURNAMENT
+// Every pair of entrants plays head-to-head games (sides swap each seed),
+// plus optional free-for-all games with everyone. Games run on a thread
+// pool. Ratings are updated in schedule order as soon as each game's
+// result is in, so the table doesn't depend on thread timing. Results are
+// cached by a hash of (roster, map, steps, seed), where a script entrant
+// also counts its file contents: a rerun, or a run with a new entrant, only
+// plays games it hasn't seen. A new entrant changes the free-for-all roster
+// though, so every free-for-all game is played again.
+const char* const ROBOT_TYPES[] = {
+    "GenericRobot", "HideBot", "JumpBot", "LongShotBot", "SemiAutoBot", "ThirtyShotBot",
+    "ScoutBot", "TrackBot", "PlusShooter", "CrossShooter", "DoubleRowShooter"
+};
+const double ELO_K = 16;
+
+struct TournamentGame {
+    vector<int> players; // entrant indexes, in roster (turn) order
+    unsigned seed = 0;
+    unsigned long long key = 0; // cache key
+    int winner = -2;        // entrant index, -1 for a draw, -2 while unplayed
+    bool cached = false;
+};
+
+// FNV-1a over the description, then mixed
+unsigned long long tournamentKey(const GameSetup& config, unsigned seed, const vector<string>& roster) {
+    string text = to_string(config.width) + "x" + to_string(config.height) + " steps=" + to_string(config.numTurns) +
+                  " seed=" + to_string(seed);
+    if (config.stalemateTurns > 0) text += " stalemate=" + to_string(config.stalemateTurns);
+    for (const string& type : roster) text += " " + type;
+    unsigned long long h = 1469598103934665603ULL;
+    for (unsigned char ch : text) h = (h ^ ch) * 1099511628211ULL;
+    return mix64(h);
+}
+
+// --tournament [entrants=A,B,...] [size=10x10] [steps=100] [games=20] [ffa=0] [seed=1] [threads=N]
+//              [cache=tournament.cache] [stalemate=0]
+int runTournamentMode(int argc, char* argv[]) {
+    map<string, string> options = parseOptions(argc, argv, 2);
+    vector<string> entrants;
+    if (options.count("entrants")) {
+        stringstream list(options["entrants"]);
+        for (string type; getline(list, type, ',');) entrants.push_back(type);
+    } else {
+        entrants.assign(begin(ROBOT_TYPES), end(ROBOT_TYPES));
+    }
+    GameSetup base;
+    if (sscanf(optionOr(options, "size", "10x10").c_str(), "%dx%d", &base.width, &base.height) != 2) {
+        cerr << "Bad size (want WxH)" << endl;
+        return 1;
+    }
+    base.numTurns = stoi(optionOr(options, "steps", "100"));
+    base.stalemateTurns = stoi(optionOr(options, "stalemate", "0"));
+    int games = max(0, stoi(optionOr(options, "games", "20")));
+    int ffaGames = max(0, stoi(optionOr(options, "ffa", "0")));
+    unsigned firstSeed = (unsigned)stoul(optionOr(options, "seed", "1"));
+    int threads = max(1, stoi(optionOr(options, "threads", to_string(max(1u, thread::hardware_concurrency())))));
+    string cachePath = optionOr(options, "cache", "tournament.cache");
+    int n = (int)entrants.size();
+    if (n < 2) {
+        cerr << "A tournament needs at least two entrants" << endl;
+        return 1;
+    }
+    vector<string> keyNames; // entrant names for cache keys
+    for (const string& type : entrants) {
+        // An unknown type would lose every game by default instead of failing
+        unique_ptr<Robot> probe(makeRobot(type, "probe", 'A', 0, 0));
+        if (!probe) {
+            cerr << "Unknown entrant " << type << " (not a robot type or a loadable .bot script)" << endl;
+            return 1;
+        }
+        // A script is keyed on its contents too, so editing it invalidates its games
+        keyNames.push_back(type);
+        if (isScriptType(type)) {
+            ifstream script(type, ios::binary);
+            stringstream text;
+            text << script.rdbuf();
+            unsigned long long h = 1469598103934665603ULL;
+            for (unsigned char ch : text.str()) h = (h ^ ch) * 1099511628211ULL;
+            ostringstream tag;
+            tag << "#" << hex << mix64(h);
+            keyNames.back() += tag.str();
+        }
+    }
+
+    // Build the schedule: round-robin pairs, then free-for-alls
+    vector<TournamentGame> schedule;
+    for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            for (int g = 0; g < games; ++g) {
+                TournamentGame game;
+                game.players = g % 2 ? vector<int>{ j, i } : vector<int>{ i, j };
+                game.seed = firstSeed + g;
+                schedule.push_back(game);
+            }
+        }
+    }
+    for (int g = 0; g < ffaGames; ++g) {
+        TournamentGame game;
+        for (int i = 0; i < n; ++i) game.players.push_back(i);
+        rotate(game.players.begin(), game.players.begin() + g % n, game.players.end()); // Share first move
+        game.seed = firstSeed + g;
+        schedule.push_back(game);
+    }
+    auto rosterOf = [&](const TournamentGame& game) {
+        vector<string> roster;
+        for (int p : game.players) roster.push_back(keyNames[p]);
+        return roster;
+    };
+
+    // Cache lines: "<key hex> <winner position or -1>"
+    unordered_map<unsigned long long, int> cache;
+    {
+        ifstream in(cachePath);
+        string keyHex;
+        int position;
+        while (in >> keyHex >> position) cache[stoull(keyHex, nullptr, 16)] = position;
+    }
+    vector<size_t> todo;
+    for (size_t i = 0; i < schedule.size(); ++i) {
+        TournamentGame& game = schedule[i];
+        game.key = tournamentKey(base, game.seed, rosterOf(game));
+        auto it = cache.find(game.key);
+        if (it != cache.end()) {
+            game.winner = it->second < 0 ? -1 : game.players[it->second];
+            game.cached = true;
+        } else {
+            todo.push_back(i);
+        }
+    }
+    cout << schedule.size() << " games scheduled for " << n << " entrants, " << schedule.size() - todo.size()
+         << " from cache, " << todo.size() << " to play on " << threads << " threads" << endl;
+
+    ofstream cacheOut(cachePath, ios::app);
+    mutex lock;
+    condition_variable resultReady;
+    atomic<size_t> nextJob(0);
+    auto worker = [&]() {
+        Game arena;
+        for (size_t k = nextJob++; k < todo.size(); k = nextJob++) {
+            TournamentGame& game = schedule[todo[k]];
+            GameSetup config = base;
+            for (size_t p = 0; p < game.players.size(); ++p) {
+                config.entries.push_back({ entrants[game.players[p]], "P" + to_string(p), "random", "random" });
+            }
+            arena.setup(config, game.seed);
+            arena.play();
+            GameOutcome outcome = summarizeGame(arena, game.seed);
+            int position = outcome.winner.empty() ? -1 : stoi(outcome.winner.substr(1));
+            lock_guard<mutex> guard(lock);
+            game.winner = position < 0 ? -1 : game.players[position];
+            cacheOut << hex << game.key << dec << " " << position << "\n";
+            resultReady.notify_one();
+        }
+    };
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+
+    // Apply results in schedule order as they arrive
+    vector<double> rating(n, 1500);
+    vector<int> wins(n), draws(n), losses(n);
+    auto elo = [&](int a, int b, double scoreA, double k) {
+        double expected = 1 / (1 + pow(10, (rating[b] - rating[a]) / 400));
+        rating[a] += k * (scoreA - expected);
+        rating[b] -= k * (scoreA - expected);
+    };
+    size_t applied = 0, reportEvery = max<size_t>(1, schedule.size() / 10);
+    while (applied < schedule.size()) {
+        unique_lock<mutex> guard(lock);
+        resultReady.wait(guard, [&]() { return schedule[applied].winner != -2; });
+        while (applied < schedule.size() && schedule[applied].winner != -2) {
+            const TournamentGame& game = schedule[applied++];
+            double k = ELO_K / (game.players.size() - 1); // Free-for-alls are split into pairs
+            for (int p : game.players) {
+                if (game.winner == -1) draws[p]++;
+                else if (game.winner == p) wins[p]++;
+                else losses[p]++;
+            }
+            for (size_t a = 0; a < game.players.size(); ++a) {
+                for (size_t b = a + 1; b < game.players.size(); ++b) {
+                    int pa = game.players[a], pb = game.players[b];
+                    double score = game.winner == pa ? 1 : game.winner == pb ? 0 : 0.5;
+                    elo(pa, pb, score, k);
+                }
+            }
+            if (applied % reportEvery == 0 && applied < schedule.size()) {
+                int leader = (int)(max_element(rating.begin(), rating.end()) - rating.begin());
+                cout << "  " << applied << "/" << schedule.size() << " games, leader " << entrants[leader] << " ("
+                     << fixed << setprecision(0) << rating[leader] << ")" << endl;
+            }
+        }
+    }
+    for (thread& w : workers) w.join();
+
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](int a, int b) { return rating[a] > rating[b]; });
+    cout << "\n" << left << setw(5) << "Rank" << setw(24) << "Entrant" << right << setw(8) << "Elo" << setw(7) << "Won"
+         << setw(7) << "Drawn" << setw(7) << "Lost" << "\n";
+    for (int rank = 0; rank < n; ++rank) {
+        int i = order[rank];
+        cout << left << setw(5) << rank + 1 << setw(24) << entrants[i] << right << setw(8) << fixed << setprecision(0)
+             << rating[i] << setw(7) << wins[i] << setw(7) << draws[i] << setw(7) << losses[i] << "\n";
+    }
+    return 0;
+}
+
+// Main game function
+int main(int argc, char* argv[]) {
+    // metrics=<file|unix:/socket> [metrics_ms=1000] work with every mode
+    string metricsTarget;
+    int metricsMs = 1000, kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (startsWith(arg, "metrics=")) metricsTarget = arg.substr(8);
+        else if (startsWith(arg, "metrics_ms=")) metricsMs = max(10, atoi(arg.c_str() + 11));
+        else argv[kept++] = argv[i];
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    TelemetrySampler sampler;
+    if (!metricsTarget.empty() && !sampler.start(metricsTarget, metricsMs)) return 1;
+
+    // Alternate run modes
+    if (argc > 1 && string(argv[1]) == "--batch") return runBatchMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--shard") return runShardMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--serve") return runServeMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--client") return runClientMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--experiment") return runExperimentMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--heatmap") return runHeatmapMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--record") return runRecordMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--hashes") return runHashesMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--verify") return runVerifyMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--ingest") return runIngestMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--query") return runQueryMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--script-bench") return runScriptBenchMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--sweep") return runSweepMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--tournament") return runTournamentMode(argc, argv);
+
+    // Normal game: [setup] [log]
+    string setupPath = argc > 1 ? argv[1] : "setup.txt";
+    string logPath = argc > 2 ? argv[2] : "log.txt";
+
+    // Read game setup (before touching the log, so a bad path clobbers nothing)
+    ifstream setup(setupPath);
+    if (!setup) {
+        cerr << "Failed to open " << setupPath << endl;
+        return 1;
+    }
+    GameSetup config;
+    readSetup(setup, config);
+    setup.close();
+
+    ofstream logfile(logPath); // Create log file
+    streambuf* originalCout = cout.rdbuf(); // Save original cout
+
+    // Dual output (console + log file)
+    streambuf* logbuf = logfile.rdbuf();
+    class DualBuf : public streambuf {
+        streambuf *buf1, *buf2; // Two output buffers
+    public:
+        DualBuf(streambuf* b1, streambuf* b2) : buf1(b1), buf2(b2) {}
+        int overflow(int c) override {
+            if (c == EOF) return !EOF;
+            if (buf1) buf1->sputc(c); // Send to first buffer (console)
+            if (buf2) buf2->sputc(c); // Send to second buffer (log file)
+            TELEMETRY_ADD(logBytes, 1);
+            return c;
+        }
+    } dualbuf(originalCout, logbuf);
+    
+    cout.rdbuf(&dualbuf); // Redirect cout to dual output
+    
+    // Seed random generator
+    unsigned seed = config.hasSeed ? config.seed : (unsigned)time(0);
+
+    Game game;
+    TextNarrator narrator(game, cout);
+    game.bus.attach(&narrator);
+    game.setup(config, seed);
+    game.play(); // Main game loop
 
-    // Cleanup
-    for (Robot* r : robots) delete r; // Delete active robots
-    for (Robot* r : respawnQueue) delete r; // Delete respawn queue
+    game.clear(); // Cleanup
     cout.rdbuf(originalCout); // Restore cout
     logfile.close(); // Close log
     return 0;